@@ -0,0 +1,311 @@
+#!/usr/bin/env python3
+
+"""Thin ctypes wrapper around libchilly, the C++ solver built as a shared
+library (see solver/src/libchilly.h).
+
+`NativeChillySolver` answers the same questions as `ChillySolver` in
+solve.py, in the same shapes, so either can be used in its place. Unlike
+`ChillySolver` it ignores the level's "connections": a hole always leads
+to the first other hole of the level, read row by row. Levels whose
+connections pair their holes differently, see `follows_hole_rule`, have
+to be solved by `ChillySolver`.
+"""
+
+import ctypes
+import ctypes.util
+import os
+from pathlib import Path
+
+CHILLY_ABI_VERSION = 1
+CHILLY_MAX_WALK_LENGTH = 65536
+
+OK = 0
+NO_ROUTE = 1
+BUFFER_TOO_SMALL = -2
+
+SEARCHES = {"bfs": 0, "astar": 1, "bidirectional": 2, "parallel": 3}
+
+
+class ChillyError(RuntimeError):
+    pass
+
+
+class Stats(ctypes.Structure):
+    _fields_ = [
+        ("size", ctypes.c_uint32),
+        ("reserved", ctypes.c_uint32),
+        ("nodes", ctypes.c_uint64),
+        ("edges", ctypes.c_uint64),
+        ("iterations", ctypes.c_uint64),
+        ("states_expanded", ctypes.c_uint64),
+        ("states_pruned", ctypes.c_uint64),
+        ("peak_frontier", ctypes.c_uint64),
+        ("peak_bytes", ctypes.c_uint64),
+        ("graph_ms", ctypes.c_double),
+        ("search_ms", ctypes.c_double),
+    ]
+
+    def as_dict(self) -> dict:
+        return {name: getattr(self, name) for name, _ in self._fields_[2:]}
+
+
+def library_candidates() -> list[str]:
+    """Where to look for libchilly: $CHILLY_LIBRARY, the solver's build
+    directories, then the system's library path."""
+    names = ["libchilly.so", "libchilly.dylib", "libchilly.dll"]
+    candidates = []
+    if os.environ.get("CHILLY_LIBRARY"):
+        candidates.append(os.environ["CHILLY_LIBRARY"])
+    solver_dir = Path(__file__).resolve().parent / "solver"
+    for build_dir in sorted(solver_dir.glob("build*")):
+        candidates += [str(build_dir / name) for name in names]
+    found = ctypes.util.find_library("chilly")
+    if found:
+        candidates.append(found)
+    return candidates
+
+
+def load_library(path: str | None = None) -> ctypes.CDLL:
+    """Load libchilly and declare its functions.
+
+    Raise OSError if no compatible library can be found."""
+    for candidate in [path] if path else library_candidates():
+        if path is None and not os.path.exists(candidate) and os.sep in candidate:
+            continue
+        try:
+            lib = ctypes.CDLL(candidate)
+        except OSError:
+            continue
+        if lib.chilly_abi_version() != CHILLY_ABI_VERSION:
+            continue
+        break
+    else:
+        raise OSError("libchilly not found; build the solver or set CHILLY_LIBRARY")
+
+    tiles = ctypes.c_char_p
+    size_p = ctypes.POINTER(ctypes.c_size_t)
+    stats_p = ctypes.POINTER(Stats)
+    lib.chilly_status_message.restype = ctypes.c_char_p
+    lib.chilly_status_message.argtypes = [ctypes.c_int]
+    lib.chilly_shortest_path.argtypes = [
+        tiles, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+        ctypes.c_char_p, ctypes.c_size_t, size_p, stats_p,
+    ]
+    lib.chilly_coin_route.argtypes = [
+        tiles, ctypes.c_int, ctypes.c_int, ctypes.c_double,
+        ctypes.c_char_p, ctypes.c_size_t, size_p, ctypes.POINTER(ctypes.c_int), stats_p,
+    ]
+    lib.chilly_k_shortest_routes.argtypes = [
+        tiles, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_size_t,
+        ctypes.c_char_p, ctypes.c_size_t, size_p, size_p, stats_p,
+    ]
+    lib.chilly_walk_counts.argtypes = [
+        tiles, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_size_t,
+        ctypes.POINTER(ctypes.c_uint64), stats_p,
+    ]
+    lib.chilly_thresholds.argtypes = [tiles, ctypes.c_int, ctypes.c_int, size_p]
+    return lib
+
+
+def holes_of(level) -> list[tuple[int, int]]:
+    """The level's holes, read row by row."""
+    return [(x, y) for y, row in enumerate(level["data"]) for x, c in enumerate(row) if c == "O"]
+
+
+def follows_hole_rule(level) -> bool:
+    """True if the level's "connections", if any, lead every hole to the
+    first other hole, as libchilly assumes."""
+    connections = level.get("connections", None)
+    if not connections:
+        return True
+    holes = holes_of(level)
+    expected = {hole: next((other for other in holes if other != hole), hole) for hole in holes}
+    actual = {
+        (connection["src"]["x"], connection["src"]["y"]): (connection["dst"]["x"], connection["dst"]["y"])
+        for connection in connections
+    }
+    return actual == expected
+
+
+_library = None
+
+
+def library() -> ctypes.CDLL:
+    global _library
+    if _library is None:
+        _library = load_library()
+    return _library
+
+
+class Stop:
+    """A place the penguin comes to rest at, with the move that took it
+    there, shaped like the `Field`s of `ChillySolver`'s paths."""
+
+    def __init__(self, pos: tuple[int, int], id: str, move: str | None):
+        self.pos = pos
+        self.id = id
+        self.move = move
+
+    @property
+    def x(self) -> int:
+        return self.pos[0]
+
+    @property
+    def y(self) -> int:
+        return self.pos[1]
+
+    def __str__(self):
+        return f"""({self.x},{self.y} '{self.id}')"""
+
+    def __repr__(self):
+        return f"Stop({self}, {self.move})"
+
+
+class NativeChillySolver:
+    DIRECTIONS = {
+        "L": (-1, 0),
+        "R": (1, 0),
+        "D": (0, 1),
+        "U": (0, -1),
+    }
+    GLIDABLE = " $G.\xa0"
+
+    def __init__(self, level, search: str = "bfs", timeout: float = 0):
+        if not follows_hole_rule(level):
+            raise ValueError("the level's connections do not lead each hole to the first other one")
+        self.lib = library()
+        self.level_data = level["data"]
+        self.n_rows = len(self.level_data)
+        self.n_cols = len(self.level_data[0])
+        self.search = SEARCHES[search]
+        self.timeout = timeout
+        # one byte per tile; anything beyond Latin-1 blocks like a rock
+        self.tiles = b"".join(
+            bytes(ord(c) if ord(c) <= 0xFF else ord("#") for c in row.ljust(self.n_cols, "#"))
+            for row in self.level_data
+        )
+        self.holes = holes_of(level)
+        self.start = next(
+            (x, y) for y, row in enumerate(self.level_data) for x, c in enumerate(row) if c == "P"
+        )
+        # buffers are kept across calls and only ever grow
+        self._moves = ctypes.create_string_buffer(4 * self.n_rows * self.n_cols + 1)
+        self._length = ctypes.c_size_t()
+        self.stats = Stats(size=ctypes.sizeof(Stats))
+        self._directions = self.DIRECTIONS
+
+    @property
+    def directions(self):
+        return self._directions
+
+    @directions.setter
+    def directions(self, directions):
+        """Kept for `ChillySolver`'s interface: the order in which moves
+        are tried makes no difference to the native searches."""
+        self._directions = directions
+
+    def _call(self, function, args: tuple, extra: tuple = ()) -> bool:
+        """Call a function that writes moves, passing `args` before the
+        moves buffer and `extra` after it, and grow the buffer until the
+        moves fit. Return False if there is no route."""
+        while True:
+            status = function(
+                self.tiles, self.n_cols, self.n_rows, *args,
+                self._moves, len(self._moves), ctypes.byref(self._length), *extra,
+                ctypes.byref(self.stats),
+            )
+            if status == BUFFER_TOO_SMALL:
+                self._moves = ctypes.create_string_buffer(max(2 * len(self._moves), self._length.value + 1))
+                continue
+            if status == NO_ROUTE:
+                return False
+            if status != OK:
+                raise ChillyError(self.lib.chilly_status_message(status).decode())
+            return True
+
+    def tile_at(self, pos: tuple[int, int]) -> str:
+        return chr(self.tiles[pos[1] * self.n_cols + pos[0]])
+
+    def slide(self, pos: tuple[int, int], move: str) -> tuple[tuple[int, int], int]:
+        """Where a move from `pos` ends, and how many tiles it passes."""
+        dx, dy = self.DIRECTIONS[move]
+        x, y = pos
+        distance = 0
+        while True:
+            x2, y2 = (x + dx) % self.n_cols, (y + dy) % self.n_rows
+            tile = self.tile_at((x2, y2))
+            distance += 1
+            if tile == "X":
+                return (x2, y2), distance
+            if tile == "O":
+                return next(hole for hole in self.holes if hole != (x2, y2)), distance
+            if tile not in self.GLIDABLE and tile != "P":
+                return (x, y), distance - 1
+            x, y = x2, y2
+
+    def replay(self, moves: str) -> tuple[list[Stop], int]:
+        """The stops of a route and the number of tiles it covers."""
+        pos = self.start
+        path = [Stop(pos, "P", None)]
+        total = 0
+        for move in moves:
+            pos, distance = self.slide(pos, move)
+            total += distance
+            path.append(Stop(pos, self.tile_at(pos), move))
+        return path, total
+
+    def least_moves(self) -> tuple[list[Stop], int]:
+        if not self._call(self.lib.chilly_shortest_path, (self.search,)):
+            return None, None
+        return self.replay(self._moves.value.decode())
+
+    def shortest_path_across_collectibles(self) -> list[str]:
+        self.optimal = ctypes.c_int()
+        if not self._call(self.lib.chilly_coin_route, (self.timeout,), (ctypes.byref(self.optimal),)):
+            return []
+        return list(self._moves.value.decode())
+
+    def k_shortest_routes(self, k: int, collect_all: bool = False) -> list[str]:
+        lengths = (ctypes.c_size_t * k)()
+        count = ctypes.c_size_t()
+        while True:
+            status = self.lib.chilly_k_shortest_routes(
+                self.tiles, self.n_cols, self.n_rows, int(collect_all), k,
+                self._moves, len(self._moves), lengths, ctypes.byref(count), ctypes.byref(self.stats),
+            )
+            if status != BUFFER_TOO_SMALL:
+                break
+            needed = sum(lengths[i] + 1 for i in range(count.value))
+            self._moves = ctypes.create_string_buffer(needed)
+        if status == NO_ROUTE:
+            return []
+        if status != OK:
+            raise ChillyError(self.lib.chilly_status_message(status).decode())
+        routes, offset = [], 0
+        for i in range(count.value):
+            routes.append(self._moves.raw[offset:offset + lengths[i]].decode())
+            offset += lengths[i] + 1
+        return routes
+
+    def walk_counts(self, max_length: int, collect_all: bool = False) -> list[int]:
+        """Walks to an exit per length up to `max_length`, including those
+        passing a stop with the same coins more than once. `max_length` may
+        be at most CHILLY_MAX_WALK_LENGTH."""
+        if not 0 <= max_length <= CHILLY_MAX_WALK_LENGTH:
+            raise ValueError(f"max_length must be between 0 and {CHILLY_MAX_WALK_LENGTH}")
+        counts = (ctypes.c_uint64 * (max_length + 1))()
+        status = self.lib.chilly_walk_counts(
+            self.tiles, self.n_cols, self.n_rows, int(collect_all), max_length, counts, ctypes.byref(self.stats)
+        )
+        if status not in (OK, NO_ROUTE):
+            raise ChillyError(self.lib.chilly_status_message(status).decode())
+        return list(counts)
+
+    def thresholds(self) -> list[int]:
+        thresholds = (ctypes.c_size_t * 3)()
+        status = self.lib.chilly_thresholds(self.tiles, self.n_cols, self.n_rows, thresholds)
+        if status == NO_ROUTE:
+            return []
+        if status != OK:
+            raise ChillyError(self.lib.chilly_status_message(status).decode())
+        return list(thresholds)
@@ -530,14 +530,31 @@ def main():
         prog="chilly-solver", description="Solve Chilly level with a bunch of shortest-path algorithms"
     )
     parser.add_argument("-n", "--level-num", type=int, default=25, help="level number")
+    parser.add_argument(
+        "--python", action="store_true", help="use the Python solver even if libchilly can be loaded"
+    )
     args = parser.parse_args()
 
     t0 = time.time_ns()
     levels = json.load(open("levels.json", "r"))
     print(f"Parsing JSON data took {round(1e-6*(time.time_ns() - t0), 2)} ms")
 
+    Solver = ChillySolver
+    if not args.python:
+        try:
+            from chilly_native import NativeChillySolver, follows_hole_rule, library
+
+            library()
+            if follows_hole_rule(levels[args.level_num]):
+                Solver = NativeChillySolver
+                print("Using the native solver from libchilly")
+            else:
+                print("Using the Python solver: libchilly cannot follow this level's connections")
+        except OSError:
+            pass
+
     t0 = time.time_ns()
-    solver = ChillySolver(levels[args.level_num])
+    solver = Solver(levels[args.level_num])
     print(f"Building graph took {round(1e-6*(time.time_ns() - t0), 2)} ms")
 
     print("\n## Shortest paths ignoring items:")
@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boards.hpp"
+#include "chilly.hpp"
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    const std::size_t DEFAULT_REPEAT = 5;
+    const int DEFAULT_MAX_SIZE = 1024;
+    const std::size_t DEFAULT_SOLVE_MAX_COINS = 16;
+
+    /// Report format version; bump whenever names or meanings of fields change.
+    const int REPORT_VERSION = 4;
+
+    /// Timings of repeated runs of one scenario and the number of states
+    /// (graph nodes or search states) a single run processes.
+    struct measurement
+    {
+        std::vector<double> samples_ms;
+        std::size_t states{0};
+    };
+
+    /// Run `run` on a fresh subject from `prepare` `repeat` times, timing
+    /// only `run`, which returns the number of states it processed.
+    template <class Prepare, class Run>
+    measurement measure(std::string const &name, std::size_t repeat, Prepare prepare, Run run)
+    {
+        std::cerr << name << " ..." << std::endl;
+        measurement m;
+        for (std::size_t i = 0; i < repeat; ++i)
+        {
+            auto subject = prepare();
+            auto const t0 = clock::now();
+            m.states = run(*subject);
+            m.samples_ms.push_back(std::chrono::duration<double, std::milli>(clock::now() - t0).count());
+        }
+        return m;
+    }
+
+    /// Nearest-rank percentile of sorted samples.
+    double percentile(std::vector<double> const &sorted, double p)
+    {
+        std::size_t const rank = static_cast<std::size_t>(std::ceil(p / 100 * static_cast<double>(sorted.size())));
+        return sorted.at(std::clamp<std::size_t>(rank, 1, sorted.size()) - 1);
+    }
+
+    boost::json::object summarize(std::string const &name, measurement m)
+    {
+        std::sort(std::begin(m.samples_ms), std::end(m.samples_ms));
+        double const median = percentile(m.samples_ms, 50);
+        boost::json::object o;
+        o["name"] = name;
+        o["samples"] = m.samples_ms.size();
+        o["minMs"] = m.samples_ms.front();
+        o["medianMs"] = median;
+        o["p90Ms"] = percentile(m.samples_ms, 90);
+        o["p99Ms"] = percentile(m.samples_ms, 99);
+        o["maxMs"] = m.samples_ms.back();
+        o["states"] = m.states;
+        o["statesPerSecond"] = median > 0 ? static_cast<double>(m.states) / median * 1000 : 0.0;
+        return o;
+    }
+
+    boost::json::object skipped(std::string const &name, std::string const &reason)
+    {
+        return boost::json::object{{"name", name}, {"skipped", reason}};
+    }
+
+    bool is_rectangular(std::vector<std::vector<chilly::tile_t>> const &data)
+    {
+        return !data.empty() && !data.front().empty() &&
+               std::all_of(std::begin(data), std::end(data), [&data](std::vector<chilly::tile_t> const &row)
+                           { return row.size() == data.front().size(); });
+    }
+
+    std::size_t collectible_count(std::vector<std::vector<chilly::tile_t>> const &data)
+    {
+        std::size_t count = 0;
+        for (auto const &row : data)
+        {
+            count += static_cast<std::size_t>(std::count_if(std::begin(row), std::end(row), [](chilly::tile_t t)
+                                                            { return t == chilly::Coin || t == chilly::Gold; }));
+        }
+        return count;
+    }
+
+    /// Synthetic board of a given extent. The same parameters always yield
+    /// the same board, so timings stay comparable across builds.
+    struct board_variant
+    {
+        char const *name;
+        /// rocks per thousand tiles
+        unsigned rock_permille;
+        /// 0 or 1, see chilly::solver on holes
+        unsigned hole_pairs;
+    };
+
+    const std::vector<board_variant> BOARD_VARIANTS = {
+        {"sparse", 50, 0},
+        {"dense", 250, 0},
+        {"holes", 150, 1},
+    };
+
+    /// Coins on every synthetic board. The scenarios timed on them ignore
+    /// coins, which only add classes to the move graph, so a single count
+    /// does.
+    const unsigned BOARD_COINS = 8;
+
+    std::unique_ptr<chilly::solver> solver_with_graph(std::vector<std::vector<chilly::tile_t>> const &data)
+    {
+        auto s = std::make_unique<chilly::solver>(data);
+        s->graph();
+        return s;
+    }
+
+    /// Graph construction and the searches for a shortest route. A*, the
+    /// bidirectional and the parallel search discover the nodes or cells
+    /// they need themselves, so their timings include what part of the
+    /// graph they build. The last
+    /// scenario times answering again after a single tile has changed.
+    void bench_board(std::string const &prefix, std::vector<std::vector<chilly::tile_t>> const &data, std::size_t repeat,
+                     boost::json::array &results)
+    {
+        auto level_data = [&data]()
+        {
+            return std::make_unique<std::vector<std::vector<chilly::tile_t>>>(data);
+        };
+        results.emplace_back(summarize(prefix + "/graph", measure(prefix + "/graph", repeat, level_data, [](std::vector<std::vector<chilly::tile_t>> const &d)
+                                                                  { return chilly::solver(d).graph().size(); })));
+        results.emplace_back(summarize(prefix + "/shortest_path", measure(prefix + "/shortest_path", repeat, [&data]()
+                                                                          { return solver_with_graph(data); },
+                                                                          [](chilly::solver &s)
+                                                                          {
+                                                                              s.shortest_path();
+                                                                              return s.stats().states_expanded; })));
+        for (auto const &[name, mode] : {std::pair{"astar", chilly::path_search::a_star},
+                                         std::pair{"bidir", chilly::path_search::bidirectional},
+                                         std::pair{"parallel", chilly::path_search::parallel}})
+        {
+            std::string const scenario = prefix + "/shortest_path/" + name;
+            results.emplace_back(summarize(scenario, measure(scenario, repeat, [&data]()
+                                                             { return std::make_unique<chilly::solver>(data); },
+                                                             [mode](chilly::solver &s)
+                                                             {
+                                                                 s.shortest_path(mode);
+                                                                 return s.stats().states_expanded; })));
+        }
+        // turn the ice or rock tile nearest to the centre into the other
+        // one, so the edit cuts through lanes the search uses
+        std::size_t const centre = data.size() / 2 * data.size() + data.size() / 2;
+        for (std::size_t i = 0; i < data.size() * data.size(); ++i)
+        {
+            std::size_t const c = (centre + i) % (data.size() * data.size());
+            int const x = static_cast<int>(c % data.size());
+            int const y = static_cast<int>(c / data.size());
+            chilly::tile_t const tile = data[static_cast<std::size_t>(y)][static_cast<std::size_t>(x)];
+            if (tile != chilly::Ice && tile != chilly::Rock)
+                continue;
+            chilly::tile_t const edited = tile == chilly::Ice ? chilly::Rock : chilly::Ice;
+            results.emplace_back(summarize(prefix + "/set_tile", measure(prefix + "/set_tile", repeat, [&data]()
+                                                                         {
+                                                                             auto s = solver_with_graph(data);
+                                                                             s->shortest_path();
+                                                                             return s; },
+                                                                         [x, y, edited](chilly::solver &s)
+                                                                         {
+                                                                             s.set_tile(x, y, edited);
+                                                                             s.shortest_path();
+                                                                             return s.stats().states_expanded; })));
+            break;
+        }
+    }
+
+    /// Pruned depth-first search for the shortest route collecting every
+    /// coin. Only run on real levels: on a random board it may enumerate
+    /// paths for ages before the first route found starts to bound it.
+    void bench_solve(std::string const &prefix, std::vector<std::vector<chilly::tile_t>> const &data, std::size_t repeat,
+                     std::size_t solve_max_coins, boost::json::array &results)
+    {
+        if (collectible_count(data) > solve_max_coins)
+        {
+            results.emplace_back(skipped(prefix + "/solve", "more than " + std::to_string(solve_max_coins) + " coins"));
+            return;
+        }
+        results.emplace_back(summarize(prefix + "/solve", measure(prefix + "/solve", repeat, [&data]()
+                                                                  { return solver_with_graph(data); },
+                                                                  [](chilly::solver &s)
+                                                                  {
+                                                                      chilly::solve_options options;
+                                                                      options.prune = true;
+                                                                      s.solve(1, options);
+                                                                      return s.stats().states_expanded; })));
+    }
+
+    /// Print how the median of every scenario compares to a previous report.
+    void compare(boost::json::array &results, boost::json::value const &baseline)
+    {
+        std::map<std::string, double> before;
+        for (auto const &v : baseline.as_object().at("scenarios").as_array())
+        {
+            auto const &o = v.as_object();
+            if (o.contains("medianMs"))
+            {
+                before[boost::json::value_to<std::string>(o.at("name"))] = o.at("medianMs").as_double();
+            }
+        }
+        std::cerr << std::left << std::setw(40) << "scenario" << std::right << std::setw(14) << "baseline ms"
+                  << std::setw(14) << "now ms" << std::setw(10) << "change" << '\n';
+        for (auto &v : results)
+        {
+            auto &o = v.as_object();
+            std::string const name = boost::json::value_to<std::string>(o.at("name"));
+            auto const it = before.find(name);
+            if (!o.contains("medianMs") || it == before.end())
+                continue;
+            double const now = o.at("medianMs").as_double();
+            double const change = it->second > 0 ? now / it->second - 1 : 0.0;
+            o["baselineMedianMs"] = it->second;
+            o["change"] = change;
+            std::cerr << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(3)
+                      << std::setw(14) << it->second << std::setw(14) << now
+                      << std::setw(9) << std::showpos << std::setprecision(1) << change * 100 << std::noshowpos << "%\n";
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t repeat = DEFAULT_REPEAT;
+    int max_size = DEFAULT_MAX_SIZE;
+    std::size_t solve_max_coins = DEFAULT_SOLVE_MAX_COINS;
+    std::string baseline_file;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc)
+        {
+            repeat = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (arg == "--max-size" && i + 1 < argc)
+        {
+            max_size = std::atoi(argv[++i]);
+        }
+        else if (arg == "--solve-max-coins" && i + 1 < argc)
+        {
+            solve_max_coins = static_cast<std::size_t>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (arg == "--baseline" && i + 1 < argc)
+        {
+            baseline_file = argv[++i];
+        }
+        else
+        {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.size() < 1)
+    {
+        std::cerr << "\nUsage: chilly_bench [OPTIONS] LEVEL_FILE\n\n"
+                  << "  LEVEL_FILE             JSON file with level data\n\n"
+                  << "Options:\n"
+                  << "  --repeat N             Time every scenario N times (default: 5)\n"
+                  << "  --max-size N           Largest synthetic board, 16 to 1024 (default: 1024)\n"
+                  << "  --solve-max-coins N    Skip the depth-first search on boards with more\n"
+                  << "                         coins (default: 16)\n"
+                  << "  --baseline FILE        Compare the medians against an earlier report\n\n"
+                  << "The report is written to stdout as JSON.\n\n";
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream ifs(args.at(0));
+    std::string input(std::istreambuf_iterator<char>(ifs), {});
+    std::vector<chilly::level> levels =
+        boost::json::value_to<std::vector<chilly::level>>(boost::json::parse(input));
+
+    boost::json::array results;
+    for (std::size_t i = 0; i < levels.size(); ++i)
+    {
+        std::string const prefix = "level/" + std::to_string(i + 1);
+        if (!is_rectangular(levels[i].data))
+        {
+            results.emplace_back(skipped(prefix, "rows differ in width"));
+            continue;
+        }
+        bench_board(prefix, levels[i].data, repeat, results);
+        bench_solve(prefix, levels[i].data, repeat, solve_max_coins, results);
+    }
+    for (int size = 16; size <= max_size; size *= 2)
+    {
+        for (std::size_t v = 0; v < BOARD_VARIANTS.size(); ++v)
+        {
+            board_variant const &variant = BOARD_VARIANTS[v];
+            std::string const prefix = "board/" + std::to_string(size) + "/" + variant.name;
+            chilly::board_spec const spec{size, size, variant.rock_permille, variant.hole_pairs, BOARD_COINS};
+            bench_board(prefix, chilly::make_random_board(spec, static_cast<std::uint64_t>(size) * 31 + v).value().data, repeat, results);
+        }
+    }
+
+    if (!baseline_file.empty())
+    {
+        std::ifstream bfs(baseline_file);
+        std::string baseline(std::istreambuf_iterator<char>(bfs), {});
+        compare(results, boost::json::parse(baseline));
+    }
+
+    boost::json::object report;
+    report["version"] = REPORT_VERSION;
+    report["repeat"] = repeat;
+    report["scenarios"] = std::move(results);
+    std::cout << boost::json::serialize(report) << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,201 @@
+#ifndef __BITBOARD_HPP__
+#define __BITBOARD_HPP__
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "chilly.hpp"
+
+namespace chilly
+{
+    /// Slide engine for boards of at most `MaxExtent` x `MaxExtent` tiles.
+    ///
+    /// Every row and every column is kept as a handful of 64-bit words, one
+    /// bit per tile: tiles that stop the penguin, holes, exits and
+    /// collectibles. A slide rotates the lane so that the tile next to the
+    /// origin lands on an end of the word and finds the first blocker with a
+    /// single count of trailing or leading zeros; the collectibles crossed on
+    /// the way are the set bits of the coin word below that blocker.
+    ///
+    /// Exposes the same `slide_from()` interface as `slide_table`, which remains
+    /// the engine for larger boards.
+    class bitboard
+    {
+    public:
+        using word = std::uint64_t;
+        static constexpr int WordBits = 64;
+        static constexpr int MaxExtent = WordBits;
+
+        static bool fits(int width, int height)
+        {
+            return width <= MaxExtent && height <= MaxExtent;
+        }
+
+        explicit bitboard(std::vector<std::vector<tile_t>> const &level_data)
+            : _width(static_cast<int>(level_data.at(0).size())), _height(static_cast<int>(level_data.size())),
+              _rows(static_cast<std::size_t>(_height)), _columns(static_cast<std::size_t>(_width))
+        {
+            for (int y = 0; y < _height; ++y)
+            {
+                for (int x = 0; x < _width; ++x)
+                {
+                    tile_t const tile = level_data.at(y).at(x);
+                    set(_rows[static_cast<std::size_t>(y)], x, tile);
+                    set(_columns[static_cast<std::size_t>(x)], y, tile);
+                }
+            }
+        }
+
+        /// Replace the tile at the normalized cell (`x`, `y`).
+        void set_tile(int x, int y, tile_t tile)
+        {
+            lane &row = _rows[static_cast<std::size_t>(y)];
+            lane &column = _columns[static_cast<std::size_t>(x)];
+            clear(row, x);
+            clear(column, y);
+            set(row, x, tile);
+            set(column, y, tile);
+        }
+
+        /// Slide from the normalized cell (`x`, `y`) into the direction of
+        /// `slot`, report every collectible crossed to `on_collectible` as a
+        /// cell index and return the cell index where the penguin comes to
+        /// rest, or `slide_table::NoStop`.
+        template <class F>
+        std::int32_t slide_from(int x, int y, int slot, tile_t &blocker, F &&on_collectible) const
+        {
+            switch (move_graph::direction_of(slot))
+            {
+            case Right:
+                return forward(_rows[static_cast<std::size_t>(y)], _width, x, blocker, [this, y](int p)
+                               { return y * _width + p; },
+                               on_collectible);
+            case Left:
+                return backward(_rows[static_cast<std::size_t>(y)], _width, x, blocker, [this, y](int p)
+                                { return y * _width + p; },
+                                on_collectible);
+            case Down:
+                return forward(_columns[static_cast<std::size_t>(x)], _height, y, blocker, [this, x](int p)
+                               { return p * _width + x; },
+                               on_collectible);
+            case Up:
+                return backward(_columns[static_cast<std::size_t>(x)], _height, y, blocker, [this, x](int p)
+                                { return p * _width + x; },
+                                on_collectible);
+            default:
+                return slide_table::NoStop;
+            }
+        }
+
+    private:
+        struct lane
+        {
+            word blockers{0};
+            word holes{0};
+            word exits{0};
+            word collectibles{0};
+        };
+
+        int _width;
+        int _height;
+        std::vector<lane> _rows;
+        std::vector<lane> _columns;
+
+        static void set(lane &l, int pos, tile_t tile)
+        {
+            word const bit = word{1} << pos;
+            switch (tile)
+            {
+            case Coin:
+            case Gold:
+                l.collectibles |= bit;
+                break;
+            case Hole:
+                l.holes |= bit;
+                l.blockers |= bit;
+                break;
+            case Exit:
+                l.exits |= bit;
+                l.blockers |= bit;
+                break;
+            default:
+                if (!slide_table::is_glidable(tile))
+                {
+                    l.blockers |= bit;
+                }
+                break;
+            }
+        }
+
+        static void clear(lane &l, int pos)
+        {
+            word const keep = static_cast<word>(~(word{1} << pos));
+            l.blockers &= keep;
+            l.holes &= keep;
+            l.exits &= keep;
+            l.collectibles &= keep;
+        }
+
+        static word low_bits(int n)
+        {
+            return n >= WordBits ? ~word{0} : static_cast<word>((word{1} << n) - 1);
+        }
+
+        /// rotate the lowest `n` bits of `v` right by `s`, 0 <= s < n
+        static word rotate(word v, int s, int n)
+        {
+            if (s == 0)
+                return v;
+            return static_cast<word>(((v >> s) | (v << (n - s))) & low_bits(n));
+        }
+
+        static tile_t blocker_at(lane const &l, int pos)
+        {
+            word const bit = word{1} << pos;
+            if (l.exits & bit)
+                return Exit;
+            if (l.holes & bit)
+                return Hole;
+            return Rock;
+        }
+
+        /// slide towards increasing positions
+        template <class Cell, class F>
+        static std::int32_t forward(lane const &l, int n, int from, tile_t &blocker, Cell &&cell, F &&on_collectible)
+        {
+            // position `from + 1` becomes bit 0
+            int const shift = (from + 1) % n;
+            word const blockers = rotate(l.blockers, shift, n);
+            if (blockers == 0)
+                return slide_table::NoStop;
+            int const distance = std::countr_zero(blockers);
+            for (word crossed = rotate(l.collectibles, shift, n) & low_bits(distance); crossed != 0; crossed &= crossed - 1)
+            {
+                on_collectible(cell((shift + std::countr_zero(crossed)) % n));
+            }
+            blocker = blocker_at(l, (shift + distance) % n);
+            return cell((from + distance) % n);
+        }
+
+        /// slide towards decreasing positions
+        template <class Cell, class F>
+        static std::int32_t backward(lane const &l, int n, int from, tile_t &blocker, Cell &&cell, F &&on_collectible)
+        {
+            // position `from` becomes bit 0, so `from - 1` is the top bit of the lane
+            word const blockers = rotate(l.blockers, from, n);
+            if (blockers == 0)
+                return slide_table::NoStop;
+            int const distance = std::countl_zero(blockers) - (WordBits - n);
+            word const span = distance == 0 ? word{0} : static_cast<word>(low_bits(distance) << (n - distance));
+            for (word crossed = rotate(l.collectibles, from, n) & span; crossed != 0; crossed &= crossed - 1)
+            {
+                on_collectible(cell((from + std::countr_zero(crossed)) % n));
+            }
+            blocker = blocker_at(l, (from + n - 1 - distance) % n);
+            return cell((from + n - distance) % n);
+        }
+    };
+}
+
+#endif // __BITBOARD_HPP__
@@ -0,0 +1,57 @@
+#include <cstddef>
+#include <random>
+
+#include "boards.hpp"
+
+namespace chilly
+{
+    std::optional<random_board> make_random_board(board_spec const &spec, std::uint64_t seed)
+    {
+        std::mt19937_64 rng(seed);
+        std::size_t const w = static_cast<std::size_t>(spec.width);
+        std::size_t const h = static_cast<std::size_t>(spec.height);
+        random_board board{std::vector<std::vector<tile_t>>(h, std::vector<tile_t>(w, Ice)), {}};
+        std::size_t free_cells = w * h;
+        for (auto &row : board.data)
+        {
+            for (auto &tile : row)
+            {
+                if (rng() % 1000 < spec.rock_permille)
+                {
+                    tile = Rock;
+                    --free_cells;
+                }
+            }
+        }
+        if (free_cells < 2 + 2 * std::size_t{spec.hole_pairs} + spec.coins)
+            return std::nullopt;
+        auto place = [&](tile_t tile)
+        {
+            for (;;)
+            {
+                std::size_t const x = rng() % w;
+                std::size_t const y = rng() % h;
+                if (board.data[y][x] == Ice)
+                {
+                    board.data[y][x] = tile;
+                    if (tile == Hole)
+                    {
+                        board.holes.push_back(coord{static_cast<int>(x), static_cast<int>(y)});
+                    }
+                    return;
+                }
+            }
+        };
+        place(Player);
+        place(Exit);
+        for (unsigned i = 0; i < 2 * spec.hole_pairs; ++i)
+        {
+            place(Hole);
+        }
+        for (unsigned i = 0; i < spec.coins; ++i)
+        {
+            place(Coin);
+        }
+        return board;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef __BOARDS_HPP__
+#define __BOARDS_HPP__
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "chilly.hpp"
+
+namespace chilly
+{
+    /// What to put on a random board.
+    struct board_spec
+    {
+        int width;
+        int height;
+        /// rocks per thousand tiles
+        unsigned rock_permille{0};
+        /// more than one pair is not connected as a level would be, see
+        /// `solver`
+        unsigned hole_pairs{0};
+        unsigned coins{0};
+    };
+
+    struct random_board
+    {
+        std::vector<std::vector<tile_t>> data;
+        /// in the order they were placed, pairs one after the other
+        std::vector<coord> holes;
+    };
+
+    /// Ice with rocks scattered over it, then the player, an exit, the holes
+    /// and the coins, each on a tile of ice picked at random. Only the raw
+    /// output of the engine seeded with `seed` is used, as distributions
+    /// differ between standard libraries, so the same arguments give the
+    /// same board on every platform. Nothing if the rocks leave too little
+    /// ice for everything else.
+    std::optional<random_board> make_random_board(board_spec const &spec, std::uint64_t seed);
+}
+
+#endif // __BOARDS_HPP__
@@ -1,35 +1,149 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <chrono>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
 #include <queue>
+#include <thread>
+#include <unordered_set>
 
+#include "bitboard.hpp"
 #include "chilly.hpp"
+#include "thread_pool.hpp"
+#include "transposition_table.hpp"
 
 namespace chilly
 {
+    namespace
+    {
+        /// Adds the wall-clock time of its own lifetime to a counter.
+        class phase_timer
+        {
+        public:
+            explicit phase_timer(double &milliseconds)
+                : _milliseconds(milliseconds), _start(std::chrono::steady_clock::now())
+            {
+            }
+            ~phase_timer()
+            {
+                _milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+            }
+
+        private:
+            double &_milliseconds;
+            std::chrono::steady_clock::time_point _start;
+        };
+
+        /// Whether a search has used up the budget given by its options.
+        /// Once spent, it stays spent, so that every worker of a parallel
+        /// search notices. The clock is only read every `ClockInterval`
+        /// expanded states.
+        class search_budget
+        {
+        public:
+            explicit search_budget(solve_options const &options)
+                : _options(options)
+            {
+            }
+
+            bool spent(std::size_t iterations, std::size_t expanded)
+            {
+                if (_spent.load(std::memory_order_relaxed))
+                    return true;
+                if ((_options.max_iterations != 0 && iterations >= _options.max_iterations) ||
+                    _options.stop.stop_requested() ||
+                    (_options.deadline != std::chrono::steady_clock::time_point::max() && expanded % ClockInterval == 0 &&
+                     std::chrono::steady_clock::now() >= _options.deadline))
+                {
+                    _spent.store(true, std::memory_order_relaxed);
+                    return true;
+                }
+                return false;
+            }
+            bool spent() const
+            {
+                return _spent.load(std::memory_order_relaxed);
+            }
+
+        private:
+            static constexpr std::size_t ClockInterval = 1024;
+            solve_options const &_options;
+            std::atomic<bool> _spent{false};
+        };
+    }
+
+    void tile_decoder::feed(std::string_view utf8, std::vector<tile_t> &tiles)
+    {
+        for (char c : utf8)
+        {
+            std::uint8_t const byte = static_cast<std::uint8_t>(c);
+            if (_pending > 0)
+            {
+                if ((byte & 0xc0) == 0x80)
+                {
+                    _code_point = (_code_point << 6) | (byte & 0x3f);
+                    if (--_pending == 0)
+                    {
+                        tiles.push_back(_code_point <= 0xff ? static_cast<tile_t>(_code_point) : Rock);
+                    }
+                    continue;
+                }
+                finish(tiles);
+            }
+            if (byte < 0x80 || byte >= 0xf8 || (byte & 0xc0) == 0x80)
+            {
+                // ASCII, or a stray byte taken as it is
+                tiles.push_back(static_cast<tile_t>(byte));
+            }
+            else
+            {
+                _pending = byte >= 0xf0 ? 3 : byte >= 0xe0 ? 2 : 1;
+                _code_point = byte & (0x3f >> _pending);
+            }
+        }
+    }
+
+    void tile_decoder::finish(std::vector<tile_t> &tiles)
+    {
+        if (_pending > 0)
+        {
+            tiles.push_back(Rock);
+            _pending = 0;
+        }
+    }
+
     level tag_invoke(boost::json::value_to_tag<level>, boost::json::value const &v)
     {
         auto &o = v.as_object();
         std::vector<std::vector<tile_t>> lvl_data;
         for (auto const &value : o.at("data").as_array())
         {
-            auto row_str = boost::json::value_to<std::string>(value);
+            tile_decoder decoder;
             std::vector<tile_t> row;
-            for (char c : row_str)
-            {
-                row.push_back(static_cast<tile_t>(c));
-            }
+            auto const &row_str = value.as_string();
+            decoder.feed(std::string_view(row_str.data(), row_str.size()), row);
+            decoder.finish(row);
             lvl_data.push_back(row);
         }
+        // a level sent to the solver may not have been scored yet
         std::vector<int> thres_data;
-        for (auto const &value : o.at("thresholds").as_array())
+        if (o.contains("thresholds"))
         {
-            thres_data.push_back(static_cast<int>(value.as_int64()));
+            for (auto const &value : o.at("thresholds").as_array())
+            {
+                thres_data.push_back(static_cast<int>(value.as_int64()));
+            }
         }
         std::string name = o.contains("name")
                                ? boost::json::value_to<std::string>(o.at("name"))
                                : "<no name>";
         return {
             name,
-            static_cast<int>(o.at("basePoints").as_int64()),
+            o.contains("basePoints") ? static_cast<int>(o.at("basePoints").as_int64()) : 0,
             lvl_data,
             thres_data,
         };
@@ -58,6 +172,16 @@ namespace chilly
         return os;
     }
 
+    std::string moves_of(path const &route)
+    {
+        std::string moves;
+        for (std::size_t i = 1; i < route.size(); ++i)
+        {
+            moves.push_back(static_cast<char>(route[i].move));
+        }
+        return moves;
+    }
+
     node::node() {}
     node::node(tile_t id, int x, int y, bool explored, int visits)
         : _id(id), _x(x), _y(y), _explored(explored), _visits(visits)
@@ -145,365 +269,2277 @@ namespace chilly
         _neighbors[direction] = node;
     }
 
-    namespace json = boost::json;
-
-    void level::dump() const
+    void node::clear_neighbors()
     {
-        std::cout << "Name:       " << name << '\n'
-                  << "Points:     " << points << '\n'
-                  << "Thresholds: ";
-        for (int threshold : thresholds)
-        {
-            std::cout << threshold << ' ';
-        }
-        std::cout << '\n'
-                  << "Size:       " << data[0].size() << 'x' << data.size() << '\n';
-        for (auto const &row : data)
-        {
-            for (auto tile : row)
-            {
-                std::cout << tile;
-            }
-            std::cout << "\n";
-        }
+        _neighbors.clear();
     }
 
-    const std::vector<direction> solver::Directions =
-        {{
-            {-1, 0, Left},
-            {+1, 0, Right},
-            {0, -1, Up},
-            {0, +1, Down},
-        }};
-
-    void solver::parse_level_data()
+    int move_graph::slot_of(direction_t move)
     {
-        for (int y = 0; y < _level_height; ++y)
+        switch (move)
         {
-            for (int x = 0; x < _level_width; ++x)
-            {
-                switch (row(y).at(x))
-                {
-                case Player:
-                    std::replace(std::begin(row(y)), std::end(row(y)), Player, Ice);
-                    _root = std::make_shared<node>(Player, x, y, true, 1);
-                    _nodes[coord{x, y}] = _root;
-                    break;
-                case Hole:
-                    _holes.emplace_back(coord{x, y});
-                    break;
-                case Coin:
-                    _collectibles[coord{x, y}] = node::CoinValue;
-                    break;
-                case Gold:
-                    _collectibles[coord{x, y}] = node::GoldValue;
-                    break;
-                default:
-                    break;
-                }
-            }
+        case Left:
+            return 0;
+        case Right:
+            return 1;
+        case Up:
+            return 2;
+        case Down:
+            return 3;
+        default:
+            return -1;
         }
     }
 
-    solver::solver(std::vector<std::vector<tile_t>> const &level_data)
-        : _level_data(level_data)
+    direction_t move_graph::direction_of(int slot)
     {
-        assert(!_level_data.empty());
-        assert(!_level_data.at(0).empty());
-        _level_height = static_cast<int>(level_data.size());
-        _level_width = static_cast<int>(level_data.at(0).size());
-        parse_level_data();
+        static const direction_t SlotDirections[Slots] = {Left, Right, Up, Down};
+        return SlotDirections[slot];
     }
 
-    void solver::reset()
+    move_graph::node_id move_graph::add_node(std::shared_ptr<node> n)
     {
-        _nodes.clear();
+        _tiles.push_back(n->id());
+        _nodes.push_back(n);
+        _successors.insert(std::end(_successors), Slots, NoNode);
+        _coins.insert(std::end(_coins), Slots, 0);
+        return static_cast<node_id>(_nodes.size() - 1);
     }
 
-    inline int solver::norm_x(int x) const
+    void move_graph::set_successor(node_id from, direction_t move, node_id to, std::uint64_t coins)
     {
-        return (x + _level_width) % _level_width;
+        std::size_t const idx = static_cast<std::size_t>(from) * Slots + static_cast<std::size_t>(slot_of(move));
+        _successors.at(idx) = to;
+        _coins.at(idx) = coins;
     }
 
-    inline int solver::norm_y(int y) const
+    void move_graph::set_collectible_count(std::size_t count)
     {
-        return (y + _level_height) % _level_height;
+        _collectible_count = count;
+        _all_collected = count >= 64
+                             ? ~std::uint64_t{0}
+                             : (std::uint64_t{1} << count) - 1;
     }
 
-    std::vector<tile_t> const &solver::row(int y) const
+    std::shared_ptr<node> const &move_graph::node_at(node_id n) const
     {
-        return _level_data.at(norm_y(y));
+        return _nodes.at(static_cast<std::size_t>(n));
     }
 
-    std::vector<tile_t> &solver::row(int y)
+    std::size_t move_graph::edge_count() const
     {
-        return _level_data[norm_y(y)];
+        return static_cast<std::size_t>(std::count_if(std::begin(_successors), std::end(_successors), [](node_id n)
+                                                      { return n != NoNode; }));
     }
 
-    tile_t solver::cell(int x, int y) const
+    std::size_t move_graph::bytes() const
     {
-        return row(y).at(norm_x(x));
+        return _nodes.capacity() * sizeof(std::shared_ptr<node>) +
+               _tiles.capacity() * sizeof(tile_t) +
+               _successors.capacity() * sizeof(node_id) +
+               _coins.capacity() * sizeof(std::uint64_t);
     }
 
-    tile_t &solver::cell(int x, int y)
+    path move_graph::route(std::vector<node_id> const &ids, std::vector<direction_t> const &moves) const
     {
-        return _level_data[norm_y(y)][norm_x(x)];
+        assert(ids.size() == moves.size());
+        path result;
+        result.reserve(ids.size());
+        for (std::size_t i = 0; i < ids.size(); ++i)
+        {
+            result.emplace_back(result_node{node_at(ids[i]), moves[i]});
+        }
+        return result;
     }
 
-    void solver::unexplore_all_nodes()
+    path move_graph::route(packed_route const &moves) const
     {
-        for (auto [_coord, node] : _nodes)
+        path result;
+        result.reserve(moves.size() + 1);
+        node_id n = root();
+        result.emplace_back(result_node{node_at(n), NoDirection});
+        for (std::size_t i = 0; i < moves.size(); ++i)
         {
-            if (node != _root)
-            {
-                node->set_explored(false);
-            }
+            n = successor(n, moves[i]);
+            result.emplace_back(result_node{node_at(n), direction_of(moves[i])});
         }
+        return result;
     }
 
-    std::unordered_map<coord, std::shared_ptr<node>, coord> const &solver::nodes() const
+    slide_table::slide_table(std::vector<std::vector<tile_t>> const &level_data)
+        : _width(static_cast<int>(level_data.at(0).size())), _height(static_cast<int>(level_data.size()))
     {
-        return _nodes;
+        for (int slot = 0; slot < move_graph::Slots; ++slot)
+        {
+            _slides[slot].assign(static_cast<std::size_t>(_width * _height), slide{});
+        }
+        for (int y = 0; y < _height; ++y)
+        {
+            sweep_row(level_data, y);
+        }
+        for (int x = 0; x < _width; ++x)
+        {
+            sweep_column(level_data, x);
+        }
     }
 
-    std::unordered_map<direction_t, neighbor_t> const &solver::neighbors_of(std::shared_ptr<node> origin)
+    void slide_table::update(std::vector<std::vector<tile_t>> const &level_data, int x, int y)
     {
-        if (!origin->neighbors().empty())
-            return origin->neighbors();
-
-        for (auto const &d : solver::Directions)
+        // The collectibles of a lane and direction were appended in one go,
+        // so the entries its slides refer to form a single block.
+        auto retire = [this](int slot, int first_cell, int step, int n)
         {
-            int x = origin->x();
-            int y = origin->y();
-            int x_step = 0;
-            int y_step = 0;
-            static const std::vector<tile_t> Glidable = {Ice, Coin, Gold, Marker, Empty};
-            std::vector<collectible_t> collected;
-            while (std::find(std::begin(Glidable), std::end(Glidable), cell(x + d.x, y + d.y)) != std::end(Glidable))
-            {
-                x += d.x;
-                y += d.y;
-                switch (cell(x, y))
-                {
-                case Coin:
-                    collected.emplace_back(collectible_t{x, y, node::CoinValue});
-                    break;
-                case Gold:
-                    collected.emplace_back(collectible_t{x, y, node::GoldValue});
-                    break;
-                default:
-                    break;
-                }
-                x_step += d.x;
-                y_step += d.y;
-                if (abs(x_step) > _level_width || abs(y_step) > _level_height) // prevent infinite looping
-                    return origin->neighbors();
-            }
-            tile_t const stop_tile = cell(x + d.x, y + d.y);
-            switch (stop_tile)
-            {
-            case Exit:
-            {
-                auto const &key = coord{norm_x(x + d.x), norm_y(y + d.y)};
-                if (_nodes.find(key) == std::end(_nodes))
-                {
-                    _nodes[key] = std::make_shared<node>(Exit, norm_x(x + d.x), norm_y(y + d.y), false);
-                }
-                origin->add_neighbor(d.move, neighbor_t{_nodes[key], collected});
-                break;
-            }
-            case Hole:
+            std::uint32_t begin = UINT32_MAX;
+            std::uint32_t end = 0;
+            for (int i = 0; i < n; ++i)
             {
-                auto other_hole = std::find_if(std::begin(_holes), std::end(_holes), [x, y, &d](coord const &hole)
-                                               { return hole.x != (x + d.x) || hole.y != (y + d.y); });
-                auto const &key = coord{x + d.x, y + d.y};
-                if (_nodes.find(key) == std::end(_nodes))
+                slide &s = _slides[slot][static_cast<std::size_t>(first_cell + i * step)];
+                if (s.coins_begin < s.coins_end)
                 {
-                    _nodes[key] = std::make_shared<node>(Hole, other_hole->x, other_hole->y, false);
+                    begin = std::min(begin, s.coins_begin);
+                    end = std::max(end, s.coins_end);
                 }
-                origin->add_neighbor(d.move, neighbor_t{_nodes[key], collected});
-                break;
+                s = slide{};
             }
-            default:
+            if (begin < end)
             {
-                if (norm_x(x) != origin->x() || norm_y(y) != origin->y())
-                {
-                    auto const &key = coord{norm_x(x), norm_y(y)};
-                    if (_nodes.find(key) == std::end(_nodes))
-                    {
-                        _nodes[key] = std::make_shared<node>(stop_tile, norm_x(x), norm_y(y), false);
-                    }
-                    origin->add_neighbor(d.move, neighbor_t{_nodes[key], collected});
-                }
-                break;
+                _stale_coins += end - begin;
             }
-            }
-        }
+        };
+        retire(move_graph::slot_of(Right), y * _width, 1, _width);
+        retire(move_graph::slot_of(Left), y * _width, 1, _width);
+        retire(move_graph::slot_of(Down), x, _width, _height);
+        retire(move_graph::slot_of(Up), x, _width, _height);
+        sweep_row(level_data, y);
+        sweep_column(level_data, x);
 
-        return origin->neighbors();
+        std::size_t entries = 0;
+        for (auto const &coins : _coins)
+        {
+            entries += coins.size();
+        }
+        if (_stale_coins > entries - _stale_coins)
+        {
+            *this = slide_table(level_data);
+        }
     }
 
-    path solver::backtraced_route(std::shared_ptr<node> n)
+    void slide_table::sweep_row(std::vector<std::vector<tile_t>> const &level_data, int y)
     {
-        auto current_node = std::make_shared<node>(*n);
-        path route = {result_node{current_node, current_node->move()}};
-        while (current_node->has_parent())
+        std::vector<tile_t> lane;
+        std::vector<std::int32_t> cells;
+        for (int x = 0; x < _width; ++x)
         {
-            current_node = current_node->parent();
-            route.insert(std::begin(route), result_node{current_node, current_node->move()});
+            lane.push_back(level_data.at(y).at(x));
+            cells.push_back(y * _width + x);
         }
-        return route;
+        sweep(lane, cells, +1, move_graph::slot_of(Right));
+        sweep(lane, cells, -1, move_graph::slot_of(Left));
     }
 
-    solver::result solver::shortest_path()
+    void slide_table::sweep_column(std::vector<std::vector<tile_t>> const &level_data, int x)
     {
-        if (_root == nullptr)
-            return result{};
-        unexplore_all_nodes();
-        std::queue<neighbor_t> q;
-        q.push(neighbor_t{_root, {}});
-        std::size_t iterations = 0;
-        while (!q.empty())
+        std::vector<tile_t> lane;
+        std::vector<std::int32_t> cells;
+        for (int y = 0; y < _height; ++y)
         {
-            std::shared_ptr<node> current_node = q.front().node;
-            q.pop();
-            for (auto [move, neighbor] : neighbors_of(current_node))
-            {
-                ++iterations;
-                if (neighbor.node->is_exit())
-                {
-                    neighbor.node->set_parent(current_node);
-                    neighbor.node->set_move(move);
-                    return result{iterations, backtraced_route(neighbor.node)};
-                }
-                if (!neighbor.node->is_explored())
-                {
-                    neighbor.node->set_parent(current_node);
-                    neighbor.node->set_move(move);
-                    neighbor.node->set_explored(true);
-                    q.push(neighbor);
-                }
-            }
+            lane.push_back(level_data.at(y).at(x));
+            cells.push_back(y * _width + x);
         }
-        return result{};
+        sweep(lane, cells, +1, move_graph::slot_of(Down));
+        sweep(lane, cells, -1, move_graph::slot_of(Up));
     }
 
-    void solver::collect_nodes()
+    bool slide_table::is_glidable(tile_t tile)
     {
-        _nodes.clear();
-        if (_root == nullptr)
-            return;
-        std::function<void(std::shared_ptr<node>)> DFS;
-
-        DFS = [&DFS, this](std::shared_ptr<node> current_node)
+        switch (tile)
         {
-            // std::cout << current_node->x() << ',' << current_node->y() << '\n';
+        case Ice:
+        case Coin:
+        case Gold:
+        case Marker:
+        case Empty:
+            return true;
+        default:
+            return false;
+        }
+    }
 
-            if (current_node->is_exit())
+    void slide_table::sweep(std::vector<tile_t> const &lane, std::vector<std::int32_t> const &cells, int step, int slot)
+    {
+        int const n = static_cast<int>(lane.size());
+        auto const first_blocker = std::find_if_not(std::begin(lane), std::end(lane), is_glidable);
+        if (first_blocker == std::end(lane))
+            return; // nothing stops the penguin in this lane
+        int const b = static_cast<int>(std::distance(std::begin(lane), first_blocker));
+        std::vector<slide> &slides = _slides[slot];
+        std::vector<std::int32_t> &coins = _coins[slot];
+        std::uint32_t run_begin = static_cast<std::uint32_t>(coins.size());
+        // Walk the lane against the direction of motion, starting next to a
+        // blocker, so that the cell ahead of the current one is always done.
+        for (int k = 1; k <= n; ++k)
+        {
+            int const i = ((b - k * step) % n + n) % n;
+            int const ahead = (i + step + n) % n;
+            slide &s = slides[static_cast<std::size_t>(cells[i])];
+            if (!is_glidable(lane[ahead]))
             {
-                return;
+                run_begin = static_cast<std::uint32_t>(coins.size());
+                s.stop = cells[i];
+                s.blocker = lane[ahead];
             }
-            for (auto [direction, neighbor] : neighbors_of(current_node))
+            else
             {
-                if (!neighbor.node->is_explored())
+                if (lane[ahead] == Coin || lane[ahead] == Gold)
                 {
-                    neighbor.node->set_explored(true);
-                    DFS(neighbor.node);
-                    neighbor.node->set_explored(false);
+                    coins.push_back(cells[ahead]);
                 }
+                slide const &t = slides[static_cast<std::size_t>(cells[ahead])];
+                s.stop = t.stop;
+                s.blocker = t.blocker;
             }
-        };
-
-        DFS(_root);
+            s.coins_begin = run_begin;
+            s.coins_end = static_cast<std::uint32_t>(coins.size());
+        }
     }
 
-    std::vector<path> solver::solve(std::size_t keep_n_best_routes)
+    namespace
     {
-        if (_root == nullptr)
-            return std::vector<path>{};
-        unexplore_all_nodes();
-        std::vector<path> solutions;
-        solutions.reserve(keep_n_best_routes);
-        path route{result_node{_root, NoDirection}};
-
-        std::size_t iterations = 0;
-        std::function<void(std::shared_ptr<node>)> DFS;
+        /// Number of 64-bit words each node carries per bit-parallel BFS
+        /// batch. Wider blocks let the compiler keep a whole block in one
+        /// vector register, so the word-wise loops below map onto AVX-512,
+        /// AVX2 or SSE2/NEON instructions where the target has them.
+#if defined(__AVX512F__)
+        constexpr std::size_t SourceWords = 8;
+#elif defined(__AVX2__)
+        constexpr std::size_t SourceWords = 4;
+#elif defined(__SSE2__) || defined(__ARM_NEON)
+        constexpr std::size_t SourceWords = 2;
+#else
+        constexpr std::size_t SourceWords = 1;
+#endif
+        constexpr std::size_t SourcesPerBatch = 64 * SourceWords;
 
-        DFS = [&solutions, &route, &DFS, &iterations, keep_n_best_routes, this](std::shared_ptr<node> current_node)
+        /// One bit per BFS source of the current batch.
+        struct alignas(8 * SourceWords) source_block
         {
-            // std::cout << current_node->x() << ',' << current_node->y() << '\n';
+            std::uint64_t words[SourceWords];
+        };
+    }
 
-            if (current_node->is_exit())
+    /// Runs the breadth-first searches of `SourcesPerBatch` origins at once:
+    /// every node keeps one bit per origin in its frontier and visited
+    /// blocks, so a single pass over the edges advances all searches by one
+    /// level. Bits that are new to a node's visited block yield the distance
+    /// of that node from the corresponding origin.
+    distance_matrix::distance_matrix(move_graph const &g)
+        : _size(g.size()), _distances(g.size() * g.size(), Unreachable)
+    {
+        std::vector<source_block> visited(_size);
+        std::vector<source_block> frontier(_size);
+        std::vector<source_block> next(_size);
+        std::vector<move_graph::node_id> active;
+        std::vector<move_graph::node_id> reached;
+        active.reserve(_size);
+        reached.reserve(_size);
+        for (std::size_t first = 0; first < _size; first += SourcesPerBatch)
+        {
+            std::size_t const batch = std::min(SourcesPerBatch, _size - first);
+            std::fill(visited.begin(), visited.end(), source_block{});
+            std::fill(frontier.begin(), frontier.end(), source_block{});
+            active.clear();
+            for (std::size_t i = 0; i < batch; ++i)
+            {
+                std::size_t const source = first + i;
+                std::uint64_t const bit = std::uint64_t{1} << (i % 64);
+                visited[source].words[i / 64] |= bit;
+                frontier[source].words[i / 64] |= bit;
+                _distances[source * _size + source] = 0;
+                active.push_back(static_cast<move_graph::node_id>(source));
+            }
+            for (std::uint16_t level = 1; !active.empty(); ++level)
             {
-                std::unordered_map<coord, int, coord> collected;
-                if (!_collectibles.empty())
+                reached.clear();
+                for (move_graph::node_id const current : active)
                 {
-                    // simulate collection of collectibles along the route
-                    result_node last_hop = route.front();
-                    for (int i = 1; i < route.size(); ++i)
+                    source_block const &from = frontier[static_cast<std::size_t>(current)];
+                    for (int slot = 0; slot < move_graph::Slots; ++slot)
                     {
-                        auto const &hop = route.at(i);
-                        auto const &neighbor = last_hop.node->neighbors().at(hop.move);
-                        for (auto c : neighbor.collected)
+                        move_graph::node_id const to = g.successor(current, slot);
+                        if (to == move_graph::NoNode)
+                        {
+                            continue;
+                        }
+                        source_block &into = next[static_cast<std::size_t>(to)];
+                        std::uint64_t any = 0;
+                        for (std::size_t w = 0; w < SourceWords; ++w)
+                        {
+                            any |= into.words[w];
+                            into.words[w] |= from.words[w];
+                        }
+                        if (any == 0)
                         {
-                            collected[coord{c.x, c.y}] = c.value;
+                            reached.push_back(to);
                         }
-                        last_hop = hop;
                     }
                 }
-                // the following is true if all collectibles have
-                // been collected along the route, or if there's
-                // nothing to collect
-                if (collected.size() == _collectibles.size())
+                for (move_graph::node_id const current : active)
+                {
+                    frontier[static_cast<std::size_t>(current)] = source_block{};
+                }
+                active.clear();
+                for (move_graph::node_id const node : reached)
                 {
-                    if (solutions.empty())
+                    std::size_t const n = static_cast<std::size_t>(node);
+                    source_block fresh;
+                    std::uint64_t any = 0;
+                    for (std::size_t w = 0; w < SourceWords; ++w)
                     {
-                        solutions.push_back(route);
+                        fresh.words[w] = next[n].words[w] & ~visited[n].words[w];
+                        visited[n].words[w] |= fresh.words[w];
+                        any |= fresh.words[w];
                     }
-                    else if (route.size() < solutions.back().size())
+                    next[n] = source_block{};
+                    if (any == 0)
                     {
-                        // limit number of best solutions
-                        if (solutions.size() < keep_n_best_routes)
-                        {
-                            solutions.push_back(route);
-                        }
-                        else
-                        {
-                            solutions.back() = route;
-                        }
+                        continue;
                     }
-                    // sort solution by route length to make std::unique() work
-                    std::sort(std::begin(solutions), std::end(solutions), [](path const &a, path const &b) -> bool
-                              { return a.size() < b.size(); });
-                    // remove duplicates of routes with same length
-                    auto last_valid = std::unique(std::begin(solutions), std::end(solutions), [](path const &a, path const &b) -> bool
-                                                  { return a.size() == b.size(); });
-                    solutions.erase(last_valid, std::end(solutions));
-                    std::cout << '\r' << iterations << " iterations: ";
-                    for (auto const &route : solutions)
+                    frontier[n] = fresh;
+                    active.push_back(node);
+                    for (std::size_t w = 0; w < SourceWords; ++w)
                     {
-                        std::cout << (route.size() - 1) << ' ';
+                        for (std::uint64_t bits = fresh.words[w]; bits != 0; bits &= bits - 1)
+                        {
+                            std::size_t const source = first + 64 * w + static_cast<std::size_t>(std::countr_zero(bits));
+                            _distances[source * _size + n] = level;
+                        }
                     }
                 }
-                return;
             }
-            for (auto [direction, neighbor] : neighbors_of(current_node))
+        }
+    }
+
+    bool distance_matrix::walk(move_graph const &g, move_graph::node_id from, move_graph::node_id to,
+                               std::vector<move_graph::node_id> &ids, std::vector<direction_t> &moves) const
+    {
+        if ((*this)(from, to) == Unreachable)
+            return false;
+        // step to any successor that is one move closer to the target
+        while (from != to)
+        {
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                move_graph::node_id const next = g.successor(from, slot);
+                if (next != move_graph::NoNode && (*this)(next, to) + 1 == (*this)(from, to))
+                {
+                    ids.push_back(next);
+                    moves.push_back(move_graph::direction_of(slot));
+                    from = next;
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    route_bounds::route_bounds(move_graph const &g)
+        : _collectible_count(static_cast<std::size_t>(std::popcount(g.all_collected()))),
+          _all_collected(g.all_collected()),
+          _to_exit(g.size(), Unreachable),
+          _via_collectible(g.size() * _collectible_count, Unreachable)
+    {
+        // predecessor lists in compressed sparse row layout
+        std::vector<std::size_t> first(g.size() + 1, 0);
+        for (move_graph::node_id n = 0; n < static_cast<move_graph::node_id>(g.size()); ++n)
+        {
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                if (g.successor(n, slot) != move_graph::NoNode)
+                {
+                    ++first[static_cast<std::size_t>(g.successor(n, slot)) + 1];
+                }
+            }
+        }
+        std::partial_sum(std::begin(first), std::end(first), std::begin(first));
+        std::vector<move_graph::node_id> predecessors(first.back());
+        std::vector<std::size_t> fill(std::begin(first), std::end(first) - 1);
+        for (move_graph::node_id n = 0; n < static_cast<move_graph::node_id>(g.size()); ++n)
+        {
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                if (g.successor(n, slot) != move_graph::NoNode)
+                {
+                    predecessors[fill[static_cast<std::size_t>(g.successor(n, slot))]++] = n;
+                }
+            }
+        }
+
+        // reverse breadth-first search from all exits
+        std::queue<move_graph::node_id> q;
+        for (move_graph::node_id n = 0; n < static_cast<move_graph::node_id>(g.size()); ++n)
+        {
+            if (g.is_exit(n))
+            {
+                _to_exit[static_cast<std::size_t>(n)] = 0;
+                q.push(n);
+            }
+        }
+        while (!q.empty())
+        {
+            move_graph::node_id const current = q.front();
+            q.pop();
+            for (std::size_t i = first[static_cast<std::size_t>(current)]; i < first[static_cast<std::size_t>(current) + 1]; ++i)
+            {
+                std::size_t const p = static_cast<std::size_t>(predecessors[i]);
+                if (_to_exit[p] == Unreachable)
+                {
+                    _to_exit[p] = _to_exit[static_cast<std::size_t>(current)] + 1;
+                    q.push(predecessors[i]);
+                }
+            }
+        }
+
+        // For every collectible, seed each node with the cost of taking one
+        // of its edges that carries the collectible and then heading for the
+        // exit, then relax these costs backwards along all edges.
+        using entry = std::pair<std::int32_t, move_graph::node_id>;
+        for (std::size_t bit = 0; bit < _collectible_count; ++bit)
+        {
+            auto dist = [this, bit](move_graph::node_id n) -> std::int32_t &
+            {
+                return _via_collectible[static_cast<std::size_t>(n) * _collectible_count + bit];
+            };
+            std::priority_queue<entry, std::vector<entry>, std::greater<entry>> pq;
+            for (move_graph::node_id n = 0; n < static_cast<move_graph::node_id>(g.size()); ++n)
+            {
+                for (int slot = 0; slot < move_graph::Slots; ++slot)
+                {
+                    move_graph::node_id const next = g.successor(n, slot);
+                    if (next == move_graph::NoNode || (g.coins(n, slot) & (std::uint64_t{1} << bit)) == 0)
+                        continue;
+                    std::int32_t const cost = 1 + to_exit(next);
+                    if (cost < dist(n))
+                    {
+                        dist(n) = cost;
+                    }
+                }
+                if (dist(n) < Unreachable)
+                {
+                    pq.push(entry{dist(n), n});
+                }
+            }
+            while (!pq.empty())
+            {
+                auto const [d, current] = pq.top();
+                pq.pop();
+                if (d > dist(current))
+                    continue;
+                for (std::size_t i = first[static_cast<std::size_t>(current)]; i < first[static_cast<std::size_t>(current) + 1]; ++i)
+                {
+                    if (d + 1 < dist(predecessors[i]))
+                    {
+                        dist(predecessors[i]) = d + 1;
+                        pq.push(entry{d + 1, predecessors[i]});
+                    }
+                }
+            }
+        }
+    }
+
+    std::int32_t route_bounds::remaining(move_graph::node_id n, std::uint64_t collected) const
+    {
+        std::int32_t bound = to_exit(n);
+        std::int32_t const *via = _via_collectible.data() + static_cast<std::size_t>(n) * _collectible_count;
+        for (std::uint64_t missing = _all_collected & ~collected; missing != 0; missing &= missing - 1)
+        {
+            bound = std::max(bound, via[std::countr_zero(missing)]);
+        }
+        return bound;
+    }
+
+    graph_components::graph_components(move_graph const &g)
+        : _component(g.size(), -1)
+    {
+        // Tarjan's algorithm with an explicit call stack. A component is
+        // complete only after all components its edges lead out to, so
+        // numbering them in order of completion puts successors first.
+        std::size_t const n = g.size();
+        std::vector<std::int32_t> index(n, -1);
+        std::vector<std::int32_t> low(n, 0);
+        std::vector<bool> on_stack(n, false);
+        std::vector<move_graph::node_id> stack;
+        // nodes in the order they were assigned to a component
+        std::vector<move_graph::node_id> members;
+        members.reserve(n);
+        struct frame
+        {
+            move_graph::node_id node;
+            int slot;
+        };
+        std::vector<frame> calls;
+        std::int32_t next_index = 0;
+        auto enter = [&](move_graph::node_id v)
+        {
+            index[static_cast<std::size_t>(v)] = low[static_cast<std::size_t>(v)] = next_index++;
+            stack.push_back(v);
+            on_stack[static_cast<std::size_t>(v)] = true;
+            calls.push_back(frame{v, 0});
+        };
+        for (move_graph::node_id start = 0; start < static_cast<move_graph::node_id>(n); ++start)
+        {
+            if (index[static_cast<std::size_t>(start)] != -1)
+                continue;
+            enter(start);
+            while (!calls.empty())
+            {
+                frame &f = calls.back();
+                std::size_t const v = static_cast<std::size_t>(f.node);
+                if (f.slot < move_graph::Slots)
+                {
+                    move_graph::node_id const next = g.successor(f.node, f.slot++);
+                    if (next == move_graph::NoNode)
+                        continue;
+                    if (index[static_cast<std::size_t>(next)] == -1)
+                    {
+                        enter(next);
+                    }
+                    else if (on_stack[static_cast<std::size_t>(next)])
+                    {
+                        low[v] = std::min(low[v], index[static_cast<std::size_t>(next)]);
+                    }
+                    continue;
+                }
+                calls.pop_back();
+                if (!calls.empty())
+                {
+                    std::size_t const caller = static_cast<std::size_t>(calls.back().node);
+                    low[caller] = std::min(low[caller], low[v]);
+                }
+                if (low[v] != index[v])
+                    continue;
+                std::int32_t const c = static_cast<std::int32_t>(_collectible_from.size());
+                _collectible_from.push_back(0);
+                move_graph::node_id w;
+                do
+                {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[static_cast<std::size_t>(w)] = false;
+                    _component[static_cast<std::size_t>(w)] = c;
+                    members.push_back(w);
+                } while (static_cast<std::size_t>(w) != v);
+            }
+        }
+
+        // members come grouped by component in ascending order, so every
+        // component an edge leaves for is final by the time it is read
+        for (move_graph::node_id u : members)
+        {
+            std::uint64_t &reach = _collectible_from[static_cast<std::size_t>(component(u))];
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                move_graph::node_id const next = g.successor(u, slot);
+                if (next == move_graph::NoNode)
+                    continue;
+                reach |= g.coins(u, slot);
+                if (component(next) != component(u))
+                {
+                    reach |= collectible_from(next);
+                }
+            }
+        }
+    }
+
+    namespace json = boost::json;
+
+    solve_stats &solve_stats::operator+=(solve_stats const &other)
+    {
+        parse_ms += other.parse_ms;
+        graph_ms += other.graph_ms;
+        search_ms += other.search_ms;
+        backtrack_ms += other.backtrack_ms;
+        nodes += other.nodes;
+        edges += other.edges;
+        dead_ends += other.dead_ends;
+        collectible_classes += other.collectible_classes;
+        states_expanded += other.states_expanded;
+        states_pruned += other.states_pruned;
+        note_frontier(other.peak_frontier);
+        note_bytes(other.peak_bytes);
+        return *this;
+    }
+
+    void tag_invoke(json::value_from_tag, json::value &v, solve_stats const &stats)
+    {
+        v = json::object{
+            {"phases", json::object{
+                           {"parseMs", stats.parse_ms},
+                           {"graphMs", stats.graph_ms},
+                           {"searchMs", stats.search_ms},
+                           {"backtrackMs", stats.backtrack_ms},
+                       }},
+            {"nodes", stats.nodes},
+            {"edges", stats.edges},
+            {"deadEnds", stats.dead_ends},
+            {"collectibleClasses", stats.collectible_classes},
+            {"statesExpanded", stats.states_expanded},
+            {"statesPruned", stats.states_pruned},
+            {"peakFrontier", stats.peak_frontier},
+            {"peakBytes", stats.peak_bytes},
+        };
+    }
+
+    void level::dump() const
+    {
+        std::cout << "Name:       " << name << '\n'
+                  << "Points:     " << points << '\n'
+                  << "Thresholds: ";
+        for (int threshold : thresholds)
+        {
+            std::cout << threshold << ' ';
+        }
+        std::cout << '\n'
+                  << "Size:       " << data[0].size() << 'x' << data.size() << '\n';
+        for (auto const &row : data)
+        {
+            for (auto tile : row)
+            {
+                std::cout << tile;
+            }
+            std::cout << "\n";
+        }
+    }
+
+    const std::vector<direction> solver::Directions =
+        {{
+            {-1, 0, Left},
+            {+1, 0, Right},
+            {0, -1, Up},
+            {0, +1, Down},
+        }};
+
+    void solver::parse_level_data()
+    {
+        for (int y = 0; y < _level_height; ++y)
+        {
+            for (int x = 0; x < _level_width; ++x)
+            {
+                switch (row(y).at(x))
+                {
+                case Player:
+                    std::replace(std::begin(row(y)), std::end(row(y)), Player, Ice);
+                    _root = std::make_shared<node>(Player, x, y, true, 1);
+                    _nodes[coord{x, y}] = _root;
+                    break;
+                case Hole:
+                    _holes.emplace_back(coord{x, y});
+                    break;
+                case Coin:
+                    _collectible_bits[coord{x, y}] = static_cast<int>(_collectibles.size());
+                    _collectibles[coord{x, y}] = node::CoinValue;
+                    break;
+                case Gold:
+                    _collectible_bits[coord{x, y}] = static_cast<int>(_collectibles.size());
+                    _collectibles[coord{x, y}] = node::GoldValue;
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+    }
+
+    solver::solver(std::vector<std::vector<tile_t>> const &level_data)
+        : _level_data(level_data)
+    {
+        phase_timer timer(_stats.graph_ms);
+        assert(!_level_data.empty());
+        assert(!_level_data.at(0).empty());
+        _level_height = static_cast<int>(level_data.size());
+        _level_width = static_cast<int>(level_data.at(0).size());
+        parse_level_data();
+        if (bitboard::fits(_level_width, _level_height))
+        {
+            _bitboard = std::make_shared<bitboard>(_level_data);
+        }
+        else
+        {
+            _slides = slide_table(_level_data);
+        }
+    }
+
+    void solver::reset()
+    {
+        _nodes.clear();
+        _graph.reset();
+        _stats = solve_stats{};
+    }
+
+    inline int solver::norm_x(int x) const
+    {
+        return (x + _level_width) % _level_width;
+    }
+
+    inline int solver::norm_y(int y) const
+    {
+        return (y + _level_height) % _level_height;
+    }
+
+    std::vector<tile_t> const &solver::row(int y) const
+    {
+        return _level_data.at(norm_y(y));
+    }
+
+    std::vector<tile_t> &solver::row(int y)
+    {
+        return _level_data[norm_y(y)];
+    }
+
+    tile_t solver::cell(int x, int y) const
+    {
+        return row(y).at(norm_x(x));
+    }
+
+    tile_t &solver::cell(int x, int y)
+    {
+        return _level_data[norm_y(y)][norm_x(x)];
+    }
+
+    void solver::set_tile(int x, int y, tile_t tile)
+    {
+        x = norm_x(x);
+        y = norm_y(y);
+        bool const on_player = _root != nullptr && _root->x() == x && _root->y() == y;
+        // the player's tile is kept as ice
+        tile_t const after = tile == Player ? Ice : tile;
+        tile_t const before = cell(x, y);
+        if (tile == Player ? on_player : (after == before && !on_player))
+            return;
+
+        coord const xy{x, y};
+        if (before == Coin || before == Gold)
+        {
+            // hand the highest bit to the coin that took it, keeping bits dense
+            int const bit = _collectible_bits.at(xy);
+            int const last = static_cast<int>(_collectibles.size()) - 1;
+            for (auto &[c, b] : _collectible_bits)
+            {
+                if (b == last)
+                {
+                    b = bit;
+                    break;
+                }
+            }
+            _collectibles.erase(xy);
+            _collectible_bits.erase(xy);
+        }
+        if (after == Coin || after == Gold)
+        {
+            _collectible_bits[xy] = static_cast<int>(_collectibles.size());
+            _collectibles[xy] = after == Coin ? node::CoinValue : node::GoldValue;
+        }
+        if (before == Hole)
+        {
+            _holes.erase(std::find(std::begin(_holes), std::end(_holes), xy));
+        }
+        if (after == Hole)
+        {
+            // in reading order, as `parse_level_data()` finds them
+            _holes.insert(std::find_if(std::begin(_holes), std::end(_holes), [&xy](coord const &h)
+                                       { return h.y > xy.y || (h.y == xy.y && h.x > xy.x); }),
+                          xy);
+        }
+        cell(x, y) = after;
+        if (_bitboard != nullptr)
+        {
+            _bitboard->set_tile(x, y, after);
+        }
+        else
+        {
+            _slides.update(_level_data, x, y);
+        }
+        _graph.reset();
+
+        if (tile == Player || on_player || before == Hole || after == Hole)
+        {
+            for (auto const &[key, n] : _nodes)
+            {
+                n->clear_neighbors();
+            }
+            _nodes.clear();
+            _root = tile == Player ? std::make_shared<node>(Player, x, y, true, 1) : on_player ? nullptr : _root;
+            if (_root != nullptr)
+            {
+                _nodes[coord{_root->x(), _root->y()}] = _root;
+            }
+            return;
+        }
+        // Only slides along this row or column cross the tile or end next
+        // to it. The node stored under the tile itself may be of the wrong
+        // kind now; whatever led there is among the nodes cleared.
+        for (auto const &[key, n] : _nodes)
+        {
+            if (n->x() == x || n->y() == y)
+            {
+                n->clear_neighbors();
+            }
+        }
+        _nodes.erase(xy);
+    }
+
+    void solver::unexplore_all_nodes()
+    {
+        for (auto [_coord, node] : _nodes)
+        {
+            if (node != _root)
+            {
+                node->set_explored(false);
+            }
+        }
+    }
+
+    std::unordered_map<coord, std::shared_ptr<node>, coord> const &solver::nodes() const
+    {
+        return _nodes;
+    }
+
+    template <class Slider>
+    void solver::add_neighbors(std::shared_ptr<node> const &origin, Slider const &slider)
+    {
+        for (auto const &d : solver::Directions)
+        {
+            tile_t blocker = Rock;
+            std::vector<collectible_t> collected;
+            std::int32_t const stop = slider.slide_from(origin->x(), origin->y(), move_graph::slot_of(d.move), blocker, [this, &collected](std::int32_t c)
+                                                        {
+                                                            int const cx = c % _level_width;
+                                                            int const cy = c / _level_width;
+                                                            collected.emplace_back(collectible_t{cx, cy, _collectibles.at(coord{cx, cy})}); });
+            if (stop == slide_table::NoStop) // the penguin would glide forever
+                continue;
+            int const x = stop % _level_width;
+            int const y = stop / _level_width;
+            switch (blocker)
+            {
+            case Exit:
+            {
+                coord const key{norm_x(x + d.x), norm_y(y + d.y)};
+                origin->add_neighbor(d.move, neighbor_t{node_for(key, Exit, key.x, key.y), collected});
+                break;
+            }
+            case Hole:
+            {
+                coord const key{norm_x(x + d.x), norm_y(y + d.y)};
+                auto other_hole = std::find_if(std::begin(_holes), std::end(_holes), [&key](coord const &hole)
+                                               { return !(hole == key); });
+                if (other_hole == std::end(_holes)) // a hole without a partner leads nowhere
+                    continue;
+                origin->add_neighbor(d.move, neighbor_t{node_for(key, Hole, other_hole->x, other_hole->y), collected});
+                break;
+            }
+            default:
+            {
+                if (x != origin->x() || y != origin->y())
+                {
+                    origin->add_neighbor(d.move, neighbor_t{node_for(coord{x, y}, blocker, x, y), collected});
+                }
+                break;
+            }
+            }
+        }
+    }
+
+    std::shared_ptr<node> const &solver::node_for(coord const &key, tile_t id, int x, int y)
+    {
+        auto &n = _nodes[key];
+        if (n == nullptr)
+        {
+            // a node the backward search made up turns out to be real
+            if (auto const it = _candidates.find(key); it != std::end(_candidates))
+            {
+                n = std::move(it->second);
+                _candidates.erase(it);
+            }
+            else
+            {
+                n = std::make_shared<node>(id, x, y, false);
+            }
+        }
+        return n;
+    }
+
+    std::shared_ptr<node> const &solver::candidate_for(coord const &key, tile_t id, int x, int y)
+    {
+        if (auto const it = _nodes.find(key); it != std::end(_nodes))
+            return it->second;
+        auto &n = _candidates[key];
+        if (n == nullptr)
+        {
+            n = std::make_shared<node>(id, x, y, false);
+        }
+        return n;
+    }
+
+    namespace
+    {
+        /// tiles the penguin comes to rest in front of
+        bool stops_slide(tile_t tile)
+        {
+            return !slide_table::is_glidable(tile) && tile != Exit && tile != Hole;
+        }
+    }
+
+    /// Report every node that reaches the node stored under `key` with a
+    /// single move to `visit`, along with its key and the move. This is the
+    /// slide rule run backwards: walk the lane behind the cell the penguin
+    /// arrives at for as long as it could have glided through. Which of the
+    /// cells passed it might actually have rested on is not known without
+    /// searching forward, so every one next to a tile that stops a slide
+    /// counts. Such nodes are taken from `_candidates` and only join
+    /// `_nodes` once the player turns out to reach them.
+    template <class F>
+    void solver::predecessors_of(coord const &key, F &&visit)
+    {
+        tile_t const target = cell(key.x, key.y);
+        for (auto const &d : solver::Directions)
+        {
+            // on a stop the penguin only arrives against a blocking tile,
+            // exits and holes swallow it whatever lies behind
+            if (target != Exit && target != Hole && !stops_slide(cell(key.x + d.x, key.y + d.y)))
+                continue;
+            for (coord c{norm_x(key.x - d.x), norm_y(key.y - d.y)}; !(c == key); c = coord{norm_x(c.x - d.x), norm_y(c.y - d.y)})
+            {
+                tile_t const tile = cell(c.x, c.y);
+                if (tile == Hole)
+                {
+                    // the penguin may have come out of this hole after
+                    // falling into any hole leading here
+                    for (auto const &hole : _holes)
+                    {
+                        auto other_hole = std::find_if(std::begin(_holes), std::end(_holes), [&hole](coord const &h)
+                                                       { return !(h == hole); });
+                        if (other_hole != std::end(_holes) && *other_hole == c)
+                        {
+                            visit(hole, candidate_for(hole, Hole, c.x, c.y), d.move);
+                        }
+                    }
+                    break;
+                }
+                if (!slide_table::is_glidable(tile))
+                    break;
+                if (_root->x() == c.x && _root->y() == c.y)
+                {
+                    visit(c, _root, d.move);
+                    continue;
+                }
+                for (auto const &rest : solver::Directions)
+                {
+                    tile_t const blocker = cell(c.x + rest.x, c.y + rest.y);
+                    if (stops_slide(blocker))
+                    {
+                        visit(c, candidate_for(c, blocker, c.x, c.y), d.move);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    std::unordered_map<direction_t, neighbor_t> const &solver::neighbors_of(std::shared_ptr<node> origin)
+    {
+        if (!origin->neighbors().empty())
+            return origin->neighbors();
+
+        if (_bitboard != nullptr)
+        {
+            add_neighbors(origin, *_bitboard);
+        }
+        else
+        {
+            add_neighbors(origin, _slides);
+        }
+
+        return origin->neighbors();
+    }
+
+    solve_stats const &solver::stats() const
+    {
+        return _stats;
+    }
+
+    std::size_t solver::graph_bytes() const
+    {
+        // nodes of the pointer-based graph with their neighbor lists, plus
+        // the compiled graph
+        std::size_t bytes = _nodes.bucket_count() * sizeof(void *);
+        for (auto const &[xy, n] : _nodes)
+        {
+            bytes += sizeof(coord) + sizeof(std::shared_ptr<node>) + sizeof(node) +
+                     n->neighbors().size() * sizeof(std::pair<direction_t const, neighbor_t>);
+            for (auto const &[move, neighbor] : n->neighbors())
+            {
+                bytes += neighbor.collected.capacity() * sizeof(collectible_t);
+            }
+        }
+        return bytes + (_graph != nullptr ? _graph->bytes() : 0);
+    }
+
+    move_graph const &solver::graph()
+    {
+        if (_graph != nullptr)
+            return *_graph;
+        phase_timer timer(_stats.graph_ms);
+        _graph = std::make_shared<move_graph>();
+        if (_root == nullptr)
+        {
+            _graph->set_collectible_count(_collectibles.size());
+            return *_graph;
+        }
+
+        // Discover the nodes reachable from the player in breadth-first
+        // order; exits are terminal and therefore never expanded.
+        struct raw_edge
+        {
+            std::int32_t from;
+            direction_t move;
+            std::int32_t to;
+            std::vector<collectible_t> const *collected;
+        };
+        std::vector<std::shared_ptr<node>> order{_root};
+        std::unordered_map<node const *, std::int32_t> ids{{_root.get(), 0}};
+        std::vector<raw_edge> edges;
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            std::shared_ptr<node> const current_node = order[i];
+            if (current_node->is_exit())
+                continue;
+            for (auto const &[move, neighbor] : neighbors_of(current_node))
+            {
+                auto [it, inserted] = ids.try_emplace(neighbor.node.get(), static_cast<std::int32_t>(order.size()));
+                if (inserted)
+                {
+                    order.push_back(neighbor.node);
+                }
+                edges.push_back(raw_edge{static_cast<std::int32_t>(i), move, it->second, &neighbor.collected});
+            }
+        }
+
+        // Drop the nodes no exit can be reached from, found as the ones a
+        // backward search from the exits misses. The player stays, as the
+        // root of the graph.
+        std::vector<std::size_t> first(order.size() + 1, 0);
+        for (auto const &e : edges)
+        {
+            ++first[static_cast<std::size_t>(e.to) + 1];
+        }
+        std::partial_sum(std::begin(first), std::end(first), std::begin(first));
+        std::vector<std::int32_t> predecessors(edges.size());
+        std::vector<std::size_t> fill(std::begin(first), std::end(first) - 1);
+        for (auto const &e : edges)
+        {
+            predecessors[fill[static_cast<std::size_t>(e.to)]++] = e.from;
+        }
+        std::vector<bool> alive(order.size(), false);
+        std::vector<std::int32_t> q;
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            if (order[i]->is_exit())
+            {
+                alive[i] = true;
+                q.push_back(static_cast<std::int32_t>(i));
+            }
+        }
+        for (std::size_t head = 0; head < q.size(); ++head)
+        {
+            std::size_t const current = static_cast<std::size_t>(q[head]);
+            for (std::size_t i = first[current]; i < first[current + 1]; ++i)
+            {
+                std::size_t const p = static_cast<std::size_t>(predecessors[i]);
+                if (!alive[p])
+                {
+                    alive[p] = true;
+                    q.push_back(predecessors[i]);
+                }
+            }
+        }
+
+        // Coins that lie on the same edges of what is left form a class and
+        // share one bit. Coins on none of them all have the same, empty
+        // signature, so they share one class that no edge carries, which
+        // makes every route fall short of collecting it.
+        std::vector<std::vector<std::size_t>> signatures(_collectibles.size());
+        for (std::size_t i = 0; i < edges.size(); ++i)
+        {
+            if (!alive[static_cast<std::size_t>(edges[i].to)])
+                continue;
+            for (auto const &c : *edges[i].collected)
+            {
+                signatures[static_cast<std::size_t>(_collectible_bits.at(coord{norm_x(c.x), norm_y(c.y)}))].push_back(i);
+            }
+        }
+        std::map<std::vector<std::size_t>, std::size_t> classes;
+        std::vector<std::size_t> class_of(_collectibles.size());
+        for (std::size_t coin = 0; coin < signatures.size(); ++coin)
+        {
+            class_of[coin] = classes.try_emplace(signatures[coin], classes.size()).first->second;
+        }
+
+        alive[0] = true;
+        std::vector<move_graph::node_id> compiled(order.size(), move_graph::NoNode);
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            if (alive[i])
+            {
+                compiled[i] = _graph->add_node(order[i]);
+            }
+        }
+        _graph->set_collectible_count(classes.size());
+        for (auto const &e : edges)
+        {
+            if (!alive[static_cast<std::size_t>(e.from)] || !alive[static_cast<std::size_t>(e.to)])
+                continue;
+            std::uint64_t mask = 0;
+            for (auto const &c : *e.collected)
+            {
+                std::size_t const bit = class_of[static_cast<std::size_t>(_collectible_bits.at(coord{norm_x(c.x), norm_y(c.y)}))];
+                if (bit < MaxCollectibles)
+                {
+                    mask |= std::uint64_t{1} << bit;
+                }
+            }
+            _graph->set_successor(compiled[static_cast<std::size_t>(e.from)], e.move, compiled[static_cast<std::size_t>(e.to)], mask);
+        }
+        _stats.nodes += _graph->size();
+        _stats.edges += _graph->edge_count();
+        _stats.dead_ends += order.size() - _graph->size();
+        _stats.collectible_classes += classes.size();
+        _stats.note_bytes(graph_bytes());
+        return *_graph;
+    }
+
+    path solver::backtraced_route(move_graph const &g, std::vector<move_graph::node_id> const &parents, std::vector<direction_t> const &moves, move_graph::node_id n)
+    {
+        phase_timer timer(_stats.backtrack_ms);
+        std::vector<move_graph::node_id> ids;
+        std::vector<direction_t> route_moves;
+        for (; n != move_graph::NoNode; n = parents.at(static_cast<std::size_t>(n)))
+        {
+            ids.push_back(n);
+            route_moves.push_back(moves.at(static_cast<std::size_t>(n)));
+        }
+        std::reverse(std::begin(ids), std::end(ids));
+        std::reverse(std::begin(route_moves), std::end(route_moves));
+        return g.route(ids, route_moves);
+    }
+
+    solver::result solver::shortest_path(path_search mode, std::size_t threads)
+    {
+        if (_root == nullptr)
+            return result{};
+        switch (mode)
+        {
+        case path_search::a_star:
+            return shortest_path_a_star();
+        case path_search::bidirectional:
+            return shortest_path_bidirectional();
+        case path_search::parallel:
+            return shortest_path_parallel(threads);
+        default:
+            break;
+        }
+        move_graph const &g = graph();
+        phase_timer timer(_stats.search_ms);
+        std::vector<move_graph::node_id> parents(g.size(), move_graph::NoNode);
+        std::vector<direction_t> moves(g.size(), NoDirection);
+        std::vector<bool> explored(g.size(), false);
+        explored[move_graph::root()] = true;
+        // every node is queued at most once
+        std::vector<move_graph::node_id> q(g.size());
+        _stats.note_bytes(graph_bytes() + g.size() * (sizeof(move_graph::node_id) * 2 + sizeof(direction_t)) + g.size() / 8);
+        q[0] = move_graph::root();
+        std::size_t iterations = 0;
+        for (std::size_t head = 0, tail = 1; head < tail; ++head)
+        {
+            _stats.note_frontier(tail - head);
+            move_graph::node_id const current = q[head];
+            ++_stats.states_expanded;
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                move_graph::node_id const next = g.successor(current, slot);
+                if (next == move_graph::NoNode)
+                    continue;
+                ++iterations;
+                if (g.is_exit(next))
+                {
+                    parents[static_cast<std::size_t>(next)] = current;
+                    moves[static_cast<std::size_t>(next)] = move_graph::direction_of(slot);
+                    return result{iterations, backtraced_route(g, parents, moves, next)};
+                }
+                if (explored[static_cast<std::size_t>(next)])
+                {
+                    ++_stats.states_pruned;
+                    continue;
+                }
+                parents[static_cast<std::size_t>(next)] = current;
+                moves[static_cast<std::size_t>(next)] = move_graph::direction_of(slot);
+                explored[static_cast<std::size_t>(next)] = true;
+                q[tail++] = next;
+            }
+        }
+        return result{};
+    }
+
+    solver::result solver::shortest_path_a_star()
+    {
+        phase_timer timer(_stats.search_ms);
+        std::vector<bool> exit_columns(static_cast<std::size_t>(_level_width), false);
+        std::vector<bool> exit_rows(static_cast<std::size_t>(_level_height), false);
+        for (int y = 0; y < _level_height; ++y)
+        {
+            for (int x = 0; x < _level_width; ++x)
+            {
+                if (cell(x, y) == Exit)
+                {
+                    exit_columns[static_cast<std::size_t>(x)] = true;
+                    exit_rows[static_cast<std::size_t>(y)] = true;
+                }
+            }
+        }
+        // consistent: a move keeps the penguin in its row or column, or
+        // drops it into a hole, so the estimate falls by at most one per move
+        auto estimate = [&](node const &n) -> std::size_t
+        {
+            if (n.is_exit())
+                return 0;
+            if (!_holes.empty() || exit_columns[static_cast<std::size_t>(n.x())] || exit_rows[static_cast<std::size_t>(n.y())])
+                return 1;
+            return 2;
+        };
+
+        struct visit
+        {
+            std::shared_ptr<node> parent;
+            direction_t move;
+            std::size_t moves;
+            bool closed;
+        };
+        std::unordered_map<node const *, visit> visits{{_root.get(), visit{nullptr, NoDirection, 0, false}}};
+        // open nodes bucketed by estimated route length; as estimates never
+        // exceed two, buckets are only ever added at the back
+        std::vector<std::vector<std::shared_ptr<node>>> open(estimate(*_root) + 1);
+        open.back().push_back(_root);
+        std::size_t open_count = 1;
+        std::size_t iterations = 0;
+        for (std::size_t f = 0; f < open.size(); ++f)
+        {
+            while (!open[f].empty())
+            {
+                _stats.note_frontier(open_count);
+                std::shared_ptr<node> current = std::move(open[f].back());
+                open[f].pop_back();
+                --open_count;
+                visit &v = visits.at(current.get());
+                if (v.closed || v.moves + estimate(*current) != f)
+                    continue; // superseded by a shorter way here
+                v.closed = true;
+                if (current->is_exit())
+                {
+                    _stats.note_bytes(graph_bytes() + visits.size() * (sizeof(node const *) + sizeof(visit) + sizeof(void *)));
+                    path route;
+                    for (std::shared_ptr<node> n = current; n != nullptr;)
+                    {
+                        visit const &hop = visits.at(n.get());
+                        route.push_back(result_node{n, hop.move});
+                        n = hop.parent;
+                    }
+                    std::reverse(std::begin(route), std::end(route));
+                    return result{iterations, route};
+                }
+                ++_stats.states_expanded;
+                std::size_t const moves = v.moves + 1;
+                for (auto const &[move, neighbor] : neighbors_of(current))
+                {
+                    ++iterations;
+                    auto [it, inserted] = visits.try_emplace(neighbor.node.get(), visit{current, move, moves, false});
+                    if (!inserted)
+                    {
+                        if (it->second.moves <= moves)
+                        {
+                            ++_stats.states_pruned;
+                            continue;
+                        }
+                        it->second = visit{current, move, moves, false};
+                    }
+                    std::size_t const bucket = moves + estimate(*neighbor.node);
+                    if (bucket >= open.size())
+                    {
+                        open.resize(bucket + 1);
+                    }
+                    open[bucket].push_back(neighbor.node);
+                    ++open_count;
+                }
+            }
+        }
+        return result{iterations, {}};
+    }
+
+    solver::result solver::shortest_path_bidirectional()
+    {
+        phase_timer timer(_stats.search_ms);
+        struct forward_visit
+        {
+            std::shared_ptr<node> parent;
+            direction_t move;
+            std::size_t moves;
+        };
+        struct backward_visit
+        {
+            std::shared_ptr<node> next;
+            direction_t move;
+            std::size_t moves;
+        };
+        std::unordered_map<node const *, forward_visit> forward{{_root.get(), forward_visit{nullptr, NoDirection, 0}}};
+        std::unordered_map<node const *, backward_visit> backward;
+        std::vector<std::shared_ptr<node>> forward_frontier{_root};
+        // nodes of the backward search need their keys, which differ from
+        // their positions for holes, to find their predecessors
+        std::vector<std::pair<coord, std::shared_ptr<node>>> backward_frontier;
+        for (int y = 0; y < _level_height; ++y)
+        {
+            for (int x = 0; x < _level_width; ++x)
+            {
+                if (cell(x, y) == Exit)
+                {
+                    coord const key{x, y};
+                    std::shared_ptr<node> const &n = candidate_for(key, Exit, x, y);
+                    backward.try_emplace(n.get(), backward_visit{nullptr, NoDirection, 0});
+                    backward_frontier.emplace_back(key, n);
+                }
+            }
+        }
+
+        // the move from `from` to `to` joins the two searches
+        struct meeting
+        {
+            std::shared_ptr<node> from;
+            direction_t move{NoDirection};
+            std::shared_ptr<node> to;
+            std::size_t moves{SIZE_MAX};
+        } best;
+        auto meet = [&best](std::shared_ptr<node> const &from, direction_t move, std::shared_ptr<node> const &to, std::size_t moves)
+        {
+            if (moves < best.moves)
+            {
+                best = meeting{from, move, to, moves};
+            }
+        };
+
+        // Finish a level once the searches have met: a shorter route would
+        // have met them at a level before.
+        std::size_t iterations = 0;
+        while (best.to == nullptr && !forward_frontier.empty() && !backward_frontier.empty())
+        {
+            _stats.note_frontier(forward_frontier.size() + backward_frontier.size());
+            if (forward_frontier.size() <= backward_frontier.size())
+            {
+                std::vector<std::shared_ptr<node>> next;
+                for (auto const &current : forward_frontier)
+                {
+                    ++_stats.states_expanded;
+                    std::size_t const moves = forward.at(current.get()).moves + 1;
+                    for (auto const &[move, neighbor] : neighbors_of(current))
+                    {
+                        ++iterations;
+                        if (auto const it = backward.find(neighbor.node.get()); it != std::end(backward))
+                        {
+                            meet(current, move, neighbor.node, moves + it->second.moves);
+                        }
+                        if (!forward.try_emplace(neighbor.node.get(), forward_visit{current, move, moves}).second)
+                        {
+                            ++_stats.states_pruned;
+                            continue;
+                        }
+                        if (!neighbor.node->is_exit())
+                        {
+                            next.push_back(neighbor.node);
+                        }
+                    }
+                }
+                forward_frontier = std::move(next);
+            }
+            else
+            {
+                std::vector<std::pair<coord, std::shared_ptr<node>>> next;
+                for (auto const &[key, current] : backward_frontier)
+                {
+                    ++_stats.states_expanded;
+                    std::size_t const moves = backward.at(current.get()).moves + 1;
+                    predecessors_of(key, [&](coord const &from_key, std::shared_ptr<node> const &from, direction_t move)
+                                    {
+                                        ++iterations;
+                                        if (auto const it = forward.find(from.get()); it != std::end(forward))
+                                        {
+                                            meet(from, move, current, it->second.moves + moves);
+                                        }
+                                        if (!backward.try_emplace(from.get(), backward_visit{current, move, moves}).second)
+                                        {
+                                            ++_stats.states_pruned;
+                                            return;
+                                        }
+                                        next.emplace_back(from_key, from); });
+                }
+                backward_frontier = std::move(next);
+            }
+        }
+        _stats.note_bytes(graph_bytes() + (forward.size() + backward.size()) * (sizeof(node const *) + sizeof(forward_visit) + sizeof(void *)) +
+                          _candidates.size() * (sizeof(coord) + sizeof(std::shared_ptr<node>) + sizeof(node)));
+        // the route only passes nodes of both searches, which are in `_nodes`
+        _candidates.clear();
+        if (best.to == nullptr)
+            return result{iterations, {}};
+
+        path route;
+        for (std::shared_ptr<node> n = best.from; n != nullptr;)
+        {
+            forward_visit const &hop = forward.at(n.get());
+            route.push_back(result_node{n, hop.move});
+            n = hop.parent;
+        }
+        std::reverse(std::begin(route), std::end(route));
+        route.push_back(result_node{best.to, best.move});
+        for (std::shared_ptr<node> n = best.to;;)
+        {
+            backward_visit const &hop = backward.at(n.get());
+            if (hop.next == nullptr)
+                break;
+            route.push_back(result_node{hop.next, hop.move});
+            n = hop.next;
+        }
+        return result{iterations, route};
+    }
+
+    namespace
+    {
+        /// Chunks the cell bitmaps are split into per thread, so that
+        /// threads done early can take another one.
+        constexpr std::size_t ChunksPerThread = 4;
+        /// When the parallel breadth-first search switches direction: it
+        /// goes bottom-up once the edges out of the frontier outnumber a
+        /// `BottomUpAlpha`th of those out of unvisited cells, and top-down
+        /// again once the frontier holds less than a `TopDownBeta`th of
+        /// all cells. Values from Beamer et al., "Direction-Optimizing
+        /// Breadth-First Search".
+        constexpr std::size_t BottomUpAlpha = 14;
+        constexpr std::size_t TopDownBeta = 24;
+
+        /// Run `body(first_word, last_word)` on `pool` for chunks of the
+        /// words `[0, words)` of a cell bitmap and wait for all of them. A
+        /// chunk owns its words, so writing them needs no atomics.
+        template <class F>
+        void for_each_chunk(thread_pool &pool, std::size_t words, F const &body)
+        {
+            std::size_t const chunks = std::min(words, pool.size() * ChunksPerThread);
+            for (std::size_t i = 0; i < chunks; ++i)
+            {
+                std::size_t const first_word = words * i / chunks;
+                std::size_t const last_word = words * (i + 1) / chunks;
+                pool.submit([&body, first_word, last_word]()
+                            { body(first_word, last_word); });
+            }
+            pool.wait();
+        }
+
+        /// Lower `target` to `value` unless it holds a smaller cell already;
+        /// -1 stands for none.
+        void lower_cell(std::int32_t &target, std::int32_t value)
+        {
+            std::atomic_ref<std::int32_t> ref(target);
+            std::int32_t current = ref.load(std::memory_order_relaxed);
+            while ((current < 0 || value < current) && !ref.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+    }
+
+    /// Level-synchronous breadth-first search over cell ids instead of the
+    /// move graph: every cell the penguin can rest on is a state, and where
+    /// it leads per move is looked up once for all cells in parallel. Each
+    /// number of moves is then one step over bitmaps of the frontier, the
+    /// cells visited before and the cells found next. A step goes top-down,
+    /// from every frontier cell to its successors, or bottom-up, from every
+    /// unvisited cell to its predecessors until one is in the frontier,
+    /// whichever touches fewer edges; the predecessors are built the first
+    /// time they are needed. A cell's parent is its lowest frontier
+    /// predecessor either way, so the route found does not depend on the
+    /// number of threads.
+    solver::result solver::shortest_path_parallel(std::size_t threads)
+    {
+        constexpr std::int32_t NoCell = -1;
+        std::size_t const width = static_cast<std::size_t>(_level_width);
+        std::size_t const cells = width * static_cast<std::size_t>(_level_height);
+        std::size_t const words = (cells + 63) / 64;
+        thread_pool pool(std::max<std::size_t>(1, threads == 0 ? std::thread::hardware_concurrency() : threads));
+
+        // Where the penguin ends up from every cell per move slot: where it
+        // comes to rest, in the exit it glides into or out of the hole paired
+        // with the one it falls into. Exits end a route and lead nowhere.
+        std::vector<std::int32_t> successors(cells * move_graph::Slots, NoCell);
+        std::atomic<std::size_t> edge_count{0};
+        {
+            phase_timer timer(_stats.graph_ms);
+            auto other_hole = [this](coord const &key)
+            {
+                auto const hole = std::find_if(std::begin(_holes), std::end(_holes), [&key](coord const &h)
+                                               { return !(h == key); });
+                return hole == std::end(_holes) ? NoCell : hole->y * _level_width + hole->x;
+            };
+            auto look_up = [&](auto const &slider)
+            {
+                for_each_chunk(pool, words, [&](std::size_t first_word, std::size_t last_word)
+                               {
+                                   std::size_t edges = 0;
+                                   for (std::size_t c = first_word * 64; c < std::min(cells, last_word * 64); ++c)
+                                   {
+                                       int const x = static_cast<int>(c % width);
+                                       int const y = static_cast<int>(c / width);
+                                       if (cell(x, y) == Exit)
+                                           continue;
+                                       for (auto const &d : solver::Directions)
+                                       {
+                                           int const slot = move_graph::slot_of(d.move);
+                                           tile_t blocker = Rock;
+                                           std::int32_t const stop = slider.slide_from(x, y, slot, blocker, [](std::int32_t) {});
+                                           if (stop == slide_table::NoStop)
+                                               continue;
+                                           coord const behind{norm_x(stop % _level_width + d.x), norm_y(stop / _level_width + d.y)};
+                                           std::int32_t const target = blocker == Exit   ? behind.y * _level_width + behind.x
+                                                                       : blocker == Hole ? other_hole(behind)
+                                                                       : stop != static_cast<std::int32_t>(c) ? stop
+                                                                                                              : NoCell;
+                                           if (target == NoCell)
+                                               continue;
+                                           successors[c * move_graph::Slots + static_cast<std::size_t>(slot)] = target;
+                                           ++edges;
+                                       }
+                                   }
+                                   edge_count += edges; });
+            };
+            if (_bitboard != nullptr)
+            {
+                look_up(*_bitboard);
+            }
+            else
+            {
+                look_up(_slides);
+            }
+        }
+
+        phase_timer timer(_stats.search_ms);
+        auto degree = [&successors](std::size_t c)
+        {
+            return static_cast<std::size_t>(std::count_if(std::begin(successors) + static_cast<std::ptrdiff_t>(c * move_graph::Slots),
+                                                           std::begin(successors) + static_cast<std::ptrdiff_t>((c + 1) * move_graph::Slots),
+                                                           [](std::int32_t t)
+                                                           { return t != NoCell; }));
+        };
+        auto is_exit = [this, width](std::size_t c)
+        {
+            return cell(static_cast<int>(c % width), static_cast<int>(c / width)) == Exit;
+        };
+        std::vector<std::uint64_t> visited(words, 0);
+        std::vector<std::uint64_t> frontier(words, 0);
+        std::vector<std::uint64_t> next(words, 0);
+        std::vector<std::int32_t> parents(cells, NoCell);
+        std::vector<std::uint32_t> first_predecessor;
+        std::vector<std::int32_t> predecessors;
+        std::size_t const root = static_cast<std::size_t>(_root->y()) * width + static_cast<std::size_t>(_root->x());
+        visited[root / 64] = frontier[root / 64] = std::uint64_t{1} << (root % 64);
+        std::size_t frontier_cells = 1;
+        std::size_t frontier_edges = degree(root);
+        std::size_t unvisited_edges = edge_count - frontier_edges;
+        std::int32_t exit_reached = NoCell;
+        std::atomic<std::size_t> iterations{0};
+        std::atomic<std::size_t> expanded{0};
+        std::atomic<std::size_t> pruned{0};
+        bool bottom_up = false;
+        while (frontier_cells != 0 && exit_reached == NoCell)
+        {
+            _stats.note_frontier(frontier_cells);
+            if (!bottom_up && frontier_edges > unvisited_edges / BottomUpAlpha)
+            {
+                bottom_up = true;
+            }
+            else if (bottom_up && frontier_cells < cells / TopDownBeta)
+            {
+                bottom_up = false;
+            }
+
+            if (bottom_up && first_predecessor.empty())
+            {
+                // the slide rule in reverse, as compressed rows sorted by
+                // predecessor
+                first_predecessor.assign(cells + 1, 0);
+                for_each_chunk(pool, words, [&](std::size_t first_word, std::size_t last_word)
+                               {
+                                   for (std::size_t i = first_word * 64 * move_graph::Slots; i < std::min(cells, last_word * 64) * move_graph::Slots; ++i)
+                                   {
+                                       if (successors[i] != NoCell)
+                                       {
+                                           std::atomic_ref<std::uint32_t>(first_predecessor[static_cast<std::size_t>(successors[i]) + 1]).fetch_add(1, std::memory_order_relaxed);
+                                       }
+                                   } });
+                std::partial_sum(std::begin(first_predecessor), std::end(first_predecessor), std::begin(first_predecessor));
+                predecessors.resize(first_predecessor.back());
+                std::vector<std::uint32_t> fill(std::begin(first_predecessor), std::end(first_predecessor) - 1);
+                for_each_chunk(pool, words, [&](std::size_t first_word, std::size_t last_word)
+                               {
+                                   for (std::size_t i = first_word * 64 * move_graph::Slots; i < std::min(cells, last_word * 64) * move_graph::Slots; ++i)
+                                   {
+                                       if (successors[i] != NoCell)
+                                       {
+                                           std::uint32_t const at = std::atomic_ref<std::uint32_t>(fill[static_cast<std::size_t>(successors[i])]).fetch_add(1, std::memory_order_relaxed);
+                                           predecessors[at] = static_cast<std::int32_t>(i / move_graph::Slots);
+                                       }
+                                   } });
+                for_each_chunk(pool, words, [&](std::size_t first_word, std::size_t last_word)
+                               {
+                                   for (std::size_t c = first_word * 64; c < std::min(cells, last_word * 64); ++c)
+                                   {
+                                       std::sort(std::begin(predecessors) + first_predecessor[c], std::begin(predecessors) + first_predecessor[c + 1]);
+                                   } });
+            }
+
+            if (bottom_up)
+            {
+                for_each_chunk(pool, words, [&](std::size_t first_word, std::size_t last_word)
+                               {
+                                   std::size_t looked = 0;
+                                   std::size_t checked = 0;
+                                   for (std::size_t w = first_word; w < last_word; ++w)
+                                   {
+                                       std::uint64_t open = ~visited[w];
+                                       if (w == words - 1 && cells % 64 != 0)
+                                       {
+                                           open &= (std::uint64_t{1} << (cells % 64)) - 1;
+                                       }
+                                       for (; open != 0; open &= open - 1)
+                                       {
+                                           std::size_t const v = w * 64 + static_cast<std::size_t>(std::countr_zero(open));
+                                           ++checked;
+                                           for (std::uint32_t i = first_predecessor[v]; i < first_predecessor[v + 1]; ++i)
+                                           {
+                                               ++looked;
+                                               std::size_t const u = static_cast<std::size_t>(predecessors[i]);
+                                               if ((frontier[u / 64] >> (u % 64) & 1) == 0)
+                                                   continue;
+                                               parents[v] = predecessors[i];
+                                               next[w] |= std::uint64_t{1} << (v % 64);
+                                               if (is_exit(v))
+                                               {
+                                                   lower_cell(exit_reached, static_cast<std::int32_t>(v));
+                                               }
+                                               break;
+                                           }
+                                       }
+                                   }
+                                   iterations += looked;
+                                   expanded += checked; });
+            }
+            else
+            {
+                for_each_chunk(pool, words, [&](std::size_t first_word, std::size_t last_word)
+                               {
+                                   std::size_t looked = 0;
+                                   std::size_t taken = 0;
+                                   std::size_t seen = 0;
+                                   for (std::size_t w = first_word; w < last_word; ++w)
+                                   {
+                                       for (std::uint64_t bits = frontier[w]; bits != 0; bits &= bits - 1)
+                                       {
+                                           std::size_t const c = w * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+                                           ++taken;
+                                           for (int slot = 0; slot < move_graph::Slots; ++slot)
+                                           {
+                                               std::int32_t const t = successors[c * move_graph::Slots + static_cast<std::size_t>(slot)];
+                                               if (t == NoCell)
+                                                   continue;
+                                               ++looked;
+                                               std::size_t const target = static_cast<std::size_t>(t);
+                                               std::uint64_t const bit = std::uint64_t{1} << (target % 64);
+                                               if ((visited[target / 64] & bit) != 0)
+                                               {
+                                                   ++seen;
+                                                   continue;
+                                               }
+                                               lower_cell(parents[target], static_cast<std::int32_t>(c));
+                                               std::atomic_ref<std::uint64_t> word(next[target / 64]);
+                                               if ((word.load(std::memory_order_relaxed) & bit) == 0)
+                                               {
+                                                   word.fetch_or(bit, std::memory_order_relaxed);
+                                               }
+                                               if (is_exit(target))
+                                               {
+                                                   lower_cell(exit_reached, t);
+                                               }
+                                           }
+                                       }
+                                   }
+                                   iterations += looked;
+                                   expanded += taken;
+                                   pruned += seen; });
+            }
+
+            // the cells found make up the next frontier
+            std::atomic<std::size_t> found_cells{0};
+            std::atomic<std::size_t> found_edges{0};
+            for_each_chunk(pool, words, [&](std::size_t first_word, std::size_t last_word)
+                           {
+                               std::size_t count = 0;
+                               std::size_t edges = 0;
+                               for (std::size_t w = first_word; w < last_word; ++w)
+                               {
+                                   std::uint64_t const found = next[w];
+                                   visited[w] |= found;
+                                   frontier[w] = found;
+                                   next[w] = 0;
+                                   count += static_cast<std::size_t>(std::popcount(found));
+                                   for (std::uint64_t bits = found; bits != 0; bits &= bits - 1)
+                                   {
+                                       edges += degree(w * 64 + static_cast<std::size_t>(std::countr_zero(bits)));
+                                   }
+                               }
+                               found_cells += count;
+                               found_edges += edges; });
+            frontier_cells = found_cells;
+            frontier_edges = found_edges;
+            unvisited_edges -= frontier_edges;
+        }
+        _stats.states_expanded += expanded;
+        _stats.states_pruned += pruned;
+        _stats.note_bytes(graph_bytes() + successors.size() * sizeof(std::int32_t) + parents.size() * sizeof(std::int32_t) +
+                          3 * words * sizeof(std::uint64_t) + first_predecessor.size() * sizeof(std::uint32_t) +
+                          predecessors.size() * sizeof(std::int32_t));
+        if (exit_reached == NoCell)
+            return result{iterations, {}};
+
+        // replay the moves from the player to pick up the nodes on the way
+        phase_timer backtrack_timer(_stats.backtrack_ms);
+        std::vector<std::int32_t> route_cells;
+        for (std::int32_t c = exit_reached; c != NoCell; c = parents[static_cast<std::size_t>(c)])
+        {
+            route_cells.push_back(c);
+        }
+        std::reverse(std::begin(route_cells), std::end(route_cells));
+        path route{result_node{_root, NoDirection}};
+        for (std::size_t i = 1; i < route_cells.size(); ++i)
+        {
+            std::size_t const from = static_cast<std::size_t>(route_cells[i - 1]);
+            int slot = 0;
+            while (successors[from * move_graph::Slots + static_cast<std::size_t>(slot)] != route_cells[i])
+            {
+                ++slot;
+            }
+            direction_t const move = move_graph::direction_of(slot);
+            route.push_back(result_node{neighbors_of(route.back().node).at(move).node, move});
+        }
+        return result{iterations, route};
+    }
+
+    void solver::collect_nodes()
+    {
+        _nodes.clear();
+        if (_root == nullptr)
+            return;
+        std::function<void(std::shared_ptr<node>)> DFS;
+
+        DFS = [&DFS, this](std::shared_ptr<node> current_node)
+        {
+            // std::cout << current_node->x() << ',' << current_node->y() << '\n';
+
+            if (current_node->is_exit())
+            {
+                return;
+            }
+            for (auto const &[direction, neighbor] : neighbors_of(current_node))
             {
-                ++iterations;
                 if (!neighbor.node->is_explored())
                 {
                     neighbor.node->set_explored(true);
-                    route.emplace_back(result_node{neighbor.node, direction});
                     DFS(neighbor.node);
                     neighbor.node->set_explored(false);
-                    route.pop_back();
                 }
             }
         };
 
         DFS(_root);
+    }
+
+    std::vector<path> solver::solve(std::size_t keep_n_best_routes, solve_options const &options)
+    {
+        _proven_optimal = false;
+        if (_root == nullptr || graph().collectible_count() > MaxCollectibles)
+            return std::vector<path>{};
+        if (options.threads > 1)
+            return solve_parallel(keep_n_best_routes, options);
+        move_graph const &g = graph();
+        phase_timer timer(_stats.search_ms);
+        search_budget budget(options);
+        // the bounds also reject routes that leave a coin out of reach, but
+        // without them the components do that much cheaper
+        std::unique_ptr<route_bounds> bounds;
+        std::unique_ptr<graph_components> components;
+        if (options.prune)
+        {
+            bounds = std::make_unique<route_bounds>(g);
+        }
+        else
+        {
+            components = std::make_unique<graph_components>(g);
+        }
+        std::unique_ptr<transposition_table> transpositions;
+        if (options.transposition_bytes > 0)
+        {
+            transpositions = std::make_unique<transposition_table>(options.transposition_bytes, g.size(), g.collectible_count());
+        }
+        solve_stats &stats = _stats;
+        std::size_t const base_bytes = graph_bytes() + g.size() / 8 + (transpositions != nullptr ? transpositions->bytes() : 0);
+        std::size_t solution_bytes = 0;
+        // Routes are kept as packed moves, sorted by length, one per distinct
+        // length. A new route overwrites a discarded one or a slot of
+        // `solutions` reserved up front, so once the search has warmed up it
+        // does not allocate any more.
+        std::vector<packed_route> solutions;
+        solutions.reserve(keep_n_best_routes);
+        std::vector<bool> explored(g.size(), false);
+        explored[move_graph::root()] = true;
+        packed_route route;
+
+        std::size_t iterations = 0;
+        std::function<void(move_graph::node_id, std::uint64_t, std::uint64_t)> DFS;
+
+        // `coins_key` is the Zobrist key of `collected` if a transposition
+        // table is in use
+        DFS = [&solutions, &explored, &route, &DFS, &iterations, &g, &bounds, &transpositions, &stats, base_bytes, &solution_bytes, keep_n_best_routes, &budget, &options, &components](move_graph::node_id current, std::uint64_t collected, std::uint64_t coins_key)
+        {
+            if (budget.spent(iterations, stats.states_expanded))
+                return;
+            ++stats.states_expanded;
+            stats.note_frontier(route.size() + 1);
+            if (components != nullptr && (g.all_collected() & ~collected & ~components->collectible_from(current)) != 0)
+            {
+                // a coin left behind in a component the route cannot return to
+                ++stats.states_pruned;
+                return;
+            }
+            if (transpositions != nullptr && transpositions->seen(transpositions->node_key(current) ^ coins_key, static_cast<std::uint32_t>(route.size())))
+            {
+                ++stats.states_pruned;
+                return;
+            }
+            if (bounds != nullptr)
+            {
+                // Routes are only ever kept if they are shorter than the
+                // longest route kept so far, so a branch that cannot beat it
+                // does not change the result.
+                std::int32_t const lower_bound = bounds->remaining(current, collected);
+                if (lower_bound >= route_bounds::Unreachable ||
+                    (!solutions.empty() && route.size() + static_cast<std::size_t>(lower_bound) >= solutions.back().size()))
+                {
+                    ++stats.states_pruned;
+                    return;
+                }
+            }
+            if (g.is_exit(current))
+            {
+                // the following is true if all collectibles have
+                // been collected along the route, or if there's
+                // nothing to collect
+                if (collected != g.all_collected())
+                    return;
+                if (solutions.empty() || route.size() < solutions.back().size())
+                {
+                    if (options.on_improvement && (solutions.empty() || route.size() < solutions.front().size()))
+                    {
+                        options.on_improvement(g.route(route));
+                    }
+                    auto const slot = std::lower_bound(std::begin(solutions), std::end(solutions), route.size(), [](packed_route const &r, std::size_t size)
+                                                       { return r.size() < size; });
+                    // keep one route per length
+                    if (slot == std::end(solutions) || slot->size() != route.size())
+                    {
+                        std::ptrdiff_t const position = slot - std::begin(solutions);
+                        if (solutions.size() < keep_n_best_routes)
+                        {
+                            solutions.push_back(route);
+                        }
+                        else
+                        {
+                            solutions.back() = route;
+                        }
+                        std::rotate(std::begin(solutions) + position, std::end(solutions) - 1, std::end(solutions));
+                    }
+                    solution_bytes = 0;
+                    for (auto const &solution : solutions)
+                    {
+                        solution_bytes += solution.bytes();
+                    }
+                    stats.note_bytes(base_bytes + solution_bytes + route.bytes());
+                }
+                if (options.on_progress)
+                {
+                    std::vector<std::size_t> lengths;
+                    lengths.reserve(solutions.size());
+                    for (auto const &kept : solutions)
+                    {
+                        lengths.push_back(kept.size());
+                    }
+                    options.on_progress(iterations, lengths);
+                }
+                return;
+            }
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                move_graph::node_id const next = g.successor(current, slot);
+                if (next == move_graph::NoNode)
+                    continue;
+                ++iterations;
+                if (explored[static_cast<std::size_t>(next)])
+                {
+                    ++stats.states_pruned;
+                    continue;
+                }
+                std::uint64_t const picked_up = g.coins(current, slot) & ~collected;
+                explored[static_cast<std::size_t>(next)] = true;
+                route.push_back(slot);
+                DFS(next, collected | picked_up, picked_up == 0 || transpositions == nullptr ? coins_key : coins_key ^ transpositions->coins_key(picked_up));
+                explored[static_cast<std::size_t>(next)] = false;
+                route.pop_back();
+            }
+        };
+
+        DFS(move_graph::root(), 0, 0);
+        stats.note_bytes(base_bytes + solution_bytes + route.bytes());
+        _proven_optimal = !budget.spent() && (transpositions == nullptr || !transpositions->cut());
+
+        phase_timer backtrack_timer(stats.backtrack_ms);
+        std::vector<path> result;
+        result.reserve(solutions.size());
+        for (auto const &solution : solutions)
+        {
+            result.emplace_back(g.route(solution));
+        }
+        return result;
+    }
+
+    std::vector<path> solver::solve_parallel(std::size_t keep_n_best_routes, solve_options const &options)
+    {
+        move_graph const &g = graph();
+        phase_timer timer(_stats.search_ms);
+        search_budget budget(options);
+        route_bounds const bounds(g);
+        std::unique_ptr<graph_components> components;
+        if (!options.prune)
+        {
+            components = std::make_unique<graph_components>(g);
+        }
+        auto lower_bound = [&bounds, &options](move_graph::node_id n, std::uint64_t collected) -> std::int32_t
+        {
+            return options.prune ? bounds.remaining(n, collected) : bounds.to_exit(n);
+        };
+
+        // Shortest route per distinct length, at most `keep_n_best_routes`
+        // of them. Once that many are known, a route must have fewer nodes
+        // than `limit` to be of any use, which all workers read for pruning.
+        std::mutex solutions_mutex;
+        std::map<std::size_t, packed_route> solutions;
+        std::atomic<std::size_t> limit{SIZE_MAX};
+        std::atomic<std::size_t> iterations{0};
+        std::atomic<std::size_t> expanded{0};
+        std::atomic<std::size_t> pruned{0};
+        std::atomic<std::size_t> deepest{0};
+        // shared by all workers
+        std::unique_ptr<transposition_table> transpositions;
+        if (options.transposition_bytes > 0)
+        {
+            transpositions = std::make_unique<transposition_table>(options.transposition_bytes, g.size(), g.collectible_count());
+        }
+        auto offer = [&](std::vector<move_graph::node_id> const &route, packed_route const &moves)
+        {
+            std::lock_guard<std::mutex> lock(solutions_mutex);
+            if (route.size() >= limit.load(std::memory_order_relaxed) || solutions.count(route.size()) != 0)
+                return;
+            if (options.on_improvement && (solutions.empty() || route.size() < std::begin(solutions)->first))
+            {
+                options.on_improvement(g.route(moves));
+            }
+            solutions.emplace(route.size(), moves);
+            if (solutions.size() > keep_n_best_routes)
+            {
+                solutions.erase(std::prev(std::end(solutions)));
+            }
+            if (solutions.size() == keep_n_best_routes)
+            {
+                limit.store(std::rbegin(solutions)->first, std::memory_order_relaxed);
+            }
+        };
+
+        struct prefix
+        {
+            std::vector<move_graph::node_id> route;
+            packed_route moves;
+            std::uint64_t collected;
+        };
+
+        // Split the search tree breadth-first into enough simple-path
+        // prefixes to keep every worker busy and let stealing even out the
+        // differences in subtree size.
+        static const std::size_t TasksPerThread = 32;
+        static const std::size_t MaxSplitDepth = 12;
+        std::vector<prefix> frontier{prefix{{move_graph::root()}, {}, 0}};
+        for (std::size_t depth = 0; depth < MaxSplitDepth && !frontier.empty() && frontier.size() < options.threads * TasksPerThread; ++depth)
+        {
+            std::vector<prefix> next_frontier;
+            for (auto const &p : frontier)
+            {
+                for (int slot = 0; slot < move_graph::Slots; ++slot)
+                {
+                    move_graph::node_id const next = g.successor(p.route.back(), slot);
+                    if (next == move_graph::NoNode)
+                        continue;
+                    ++iterations;
+                    if (std::find(std::begin(p.route), std::end(p.route), next) != std::end(p.route))
+                    {
+                        ++pruned;
+                        continue;
+                    }
+                    prefix extended = p;
+                    extended.route.push_back(next);
+                    extended.moves.push_back(slot);
+                    extended.collected |= g.coins(p.route.back(), slot);
+                    if (lower_bound(next, extended.collected) >= route_bounds::Unreachable)
+                    {
+                        ++pruned;
+                        continue;
+                    }
+                    if (g.is_exit(next))
+                    {
+                        if (extended.collected == g.all_collected())
+                        {
+                            offer(extended.route, extended.moves);
+                        }
+                        continue;
+                    }
+                    next_frontier.emplace_back(std::move(extended));
+                }
+            }
+            expanded += frontier.size();
+            frontier = std::move(next_frontier);
+        }
+        _stats.note_frontier(frontier.size());
+        std::size_t prefix_bytes = 0;
+        for (auto const &p : frontier)
+        {
+            prefix_bytes += sizeof(prefix) + p.route.capacity() * sizeof(move_graph::node_id) + p.moves.bytes();
+        }
+
+        static const std::size_t IterationFlushInterval = 4096;
+        auto search = [&g, &lower_bound, &limit, &iterations, &expanded, &pruned, &deepest, &transpositions, &offer, &budget, &components](prefix task)
+        {
+            std::vector<bool> explored(g.size(), false);
+            for (auto n : task.route)
+            {
+                explored[static_cast<std::size_t>(n)] = true;
+            }
+            std::size_t local_iterations = 0;
+            std::size_t local_expanded = 0;
+            std::size_t local_pruned = 0;
+            std::size_t local_deepest = 0;
+            std::function<void(move_graph::node_id, std::uint64_t, std::uint64_t)> DFS;
+            DFS = [&](move_graph::node_id current, std::uint64_t collected, std::uint64_t coins_key)
+            {
+                if (budget.spent(iterations.load(std::memory_order_relaxed) + local_iterations, local_expanded))
+                    return;
+                if (++local_expanded % IterationFlushInterval == 0)
+                {
+                    // let the other workers see how much of the budget is gone
+                    iterations += local_iterations;
+                    local_iterations = 0;
+                }
+                if (components != nullptr && (g.all_collected() & ~collected & ~components->collectible_from(current)) != 0)
+                {
+                    ++local_pruned;
+                    return;
+                }
+                local_deepest = std::max(local_deepest, task.route.size());
+                if (transpositions != nullptr && transpositions->seen(transpositions->node_key(current) ^ coins_key, static_cast<std::uint32_t>(task.route.size())))
+                {
+                    ++local_pruned;
+                    return;
+                }
+                std::int32_t const remaining = lower_bound(current, collected);
+                if (remaining >= route_bounds::Unreachable ||
+                    task.route.size() + static_cast<std::size_t>(remaining) >= limit.load(std::memory_order_relaxed))
+                {
+                    ++local_pruned;
+                    return;
+                }
+                if (g.is_exit(current))
+                {
+                    if (collected == g.all_collected())
+                    {
+                        offer(task.route, task.moves);
+                    }
+                    return;
+                }
+                for (int slot = 0; slot < move_graph::Slots; ++slot)
+                {
+                    move_graph::node_id const next = g.successor(current, slot);
+                    if (next == move_graph::NoNode)
+                        continue;
+                    ++local_iterations;
+                    if (explored[static_cast<std::size_t>(next)])
+                    {
+                        ++local_pruned;
+                        continue;
+                    }
+                    std::uint64_t const picked_up = g.coins(current, slot) & ~collected;
+                    explored[static_cast<std::size_t>(next)] = true;
+                    task.route.push_back(next);
+                    task.moves.push_back(slot);
+                    DFS(next, collected | picked_up, picked_up == 0 || transpositions == nullptr ? coins_key : coins_key ^ transpositions->coins_key(picked_up));
+                    explored[static_cast<std::size_t>(next)] = false;
+                    task.route.pop_back();
+                    task.moves.pop_back();
+                }
+            };
+            DFS(task.route.back(), task.collected, transpositions != nullptr ? transpositions->coins_key(task.collected) : 0);
+            iterations += local_iterations;
+            expanded += local_expanded;
+            pruned += local_pruned;
+            std::size_t d = deepest.load();
+            while (d < local_deepest && !deepest.compare_exchange_weak(d, local_deepest))
+            {
+            }
+        };
 
-        return solutions;
+        thread_pool pool(options.threads);
+        for (auto &p : frontier)
+        {
+            pool.submit([&search, p = std::move(p)]()
+                        { search(p); });
+        }
+        pool.wait();
+        _proven_optimal = !budget.spent() && (transpositions == nullptr || !transpositions->cut());
+
+        _stats.states_expanded += expanded;
+        _stats.states_pruned += pruned;
+        _stats.note_frontier(deepest);
+        std::size_t solution_bytes = 0;
+        for (auto const &[length, route] : solutions)
+        {
+            solution_bytes += route.bytes();
+        }
+        // every worker holds an explored bit per node and one route at a time
+        _stats.note_bytes(graph_bytes() + prefix_bytes + solution_bytes + (transpositions != nullptr ? transpositions->bytes() : 0) +
+                          options.threads * (g.size() / 8 + deepest * sizeof(move_graph::node_id) + deepest / 4));
+
+        phase_timer backtrack_timer(_stats.backtrack_ms);
+        std::vector<path> result;
+        result.reserve(solutions.size());
+        for (auto const &[length, route] : solutions)
+        {
+            result.emplace_back(g.route(route));
+        }
+        return result;
+    }
+
+    bool solver::proven_optimal() const
+    {
+        return _proven_optimal;
+    }
+
+    solver::result solver::solve_exact()
+    {
+        if (_root == nullptr || graph().collectible_count() > MaxCollectibles)
+            return result{};
+        move_graph const &g = graph();
+        phase_timer timer(_stats.search_ms);
+        graph_components const components(g);
+
+        // Breadth-first search over the product space (stop node, set of
+        // collected coins). Every state is entered at most once, so the
+        // first exit reached with all coins collected ends a minimal route.
+        struct state
+        {
+            std::uint64_t collected;
+            move_graph::node_id node;
+            /// index of the state this one was reached from
+            std::uint32_t parent;
+            direction_t move;
+        };
+        // The nodes of the set of seen states come from pools of equally
+        // sized blocks instead of one heap allocation each. Blocks too large
+        // for a pool, such as the arrays of `states` and the buckets, go
+        // straight to the heap and back when they are replaced, so growing
+        // them leaves nothing behind.
+        std::pmr::unsynchronized_pool_resource arena;
+        std::pmr::vector<state> states(&arena);
+        states.reserve(g.size() * move_graph::Slots);
+        states.emplace_back(state{0, move_graph::root(), 0, NoDirection});
+        std::pmr::unordered_set<coin_state, coin_state> seen(&arena);
+        seen.reserve(g.size() * move_graph::Slots);
+        seen.insert(coin_state{move_graph::root(), 0});
+        std::size_t iterations = 0;
+        auto note_bytes = [this, &states, &seen]()
+        {
+            // a hash set node holds the element and a link, the table one
+            // pointer per bucket
+            _stats.note_bytes(graph_bytes() + states.capacity() * sizeof(state) +
+                              seen.size() * (sizeof(coin_state) + sizeof(void *)) + seen.bucket_count() * sizeof(void *));
+        };
+        for (std::size_t i = 0; i < states.size(); ++i)
+        {
+            _stats.note_frontier(states.size() - i);
+            ++_stats.states_expanded;
+            state const current = states[i];
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                move_graph::node_id const next = g.successor(current.node, slot);
+                if (next == move_graph::NoNode)
+                    continue;
+                ++iterations;
+                std::uint64_t const collected = current.collected | g.coins(current.node, slot);
+                if (g.is_exit(next))
+                {
+                    if (collected != g.all_collected())
+                        continue;
+                    note_bytes();
+                    phase_timer backtrack_timer(_stats.backtrack_ms);
+                    std::vector<move_graph::node_id> ids{next};
+                    std::vector<direction_t> moves{move_graph::direction_of(slot)};
+                    for (std::size_t j = i; j != 0; j = states[j].parent)
+                    {
+                        ids.push_back(states[j].node);
+                        moves.push_back(states[j].move);
+                    }
+                    ids.push_back(move_graph::root());
+                    moves.push_back(NoDirection);
+                    std::reverse(std::begin(ids), std::end(ids));
+                    std::reverse(std::begin(moves), std::end(moves));
+                    return result{iterations, g.route(ids, moves)};
+                }
+                if ((g.all_collected() & ~collected & ~components.collectible_from(next)) != 0 ||
+                    !seen.insert(coin_state{next, collected}).second)
+                {
+                    ++_stats.states_pruned;
+                    continue;
+                }
+                assert(i <= UINT32_MAX);
+                states.emplace_back(state{collected, next, static_cast<std::uint32_t>(i), move_graph::direction_of(slot)});
+            }
+        }
+        note_bytes();
+        return result{iterations, {}};
     }
 
 };
@@ -1,10 +1,17 @@
 #ifndef __CHILLY_HPP__
 #define __CHILLY_HPP__
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <stop_token>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -59,6 +66,9 @@ namespace chilly
 
     using path = std::vector<result_node>;
 
+    /// the moves of `route` as letters, without the starting node's
+    std::string moves_of(path const &route);
+
     struct direction
     {
         int x;
@@ -99,6 +109,23 @@ namespace chilly
         bool is_collectible() const;
         std::unordered_map<direction_t, neighbor_t> const &neighbors() const;
         inline void add_neighbor(direction_t direction, neighbor_t node);
+        void clear_neighbors();
+    };
+
+    /// Turns the UTF-8 of level rows into tiles, one per character: a
+    /// no-break space is the single tile `Empty`, and characters beyond
+    /// Latin-1, which no tile stands for, block like `Rock`. A row may be
+    /// fed in pieces split anywhere, even inside a character.
+    class tile_decoder
+    {
+    public:
+        void feed(std::string_view utf8, std::vector<tile_t> &tiles);
+        /// end of a row: a character cut short counts as one blocking tile
+        void finish(std::vector<tile_t> &tiles);
+
+    private:
+        std::uint32_t _code_point{0};
+        int _pending{0};
     };
 
     struct level
@@ -129,6 +156,412 @@ namespace chilly
         }
     };
 
+    class packed_route;
+
+    /// Compiled, index-based form of the move graph.
+    ///
+    /// Nodes are numbered densely in breadth-first order starting with the
+    /// player's position (id 0). Every node owns four successor slots, one per
+    /// direction, in the order of `solver::Directions`. The coins collected on
+    /// the way along an edge are kept as a bitmask in a parallel array. A bit
+    /// stands for a class of coins that lie on exactly the same edges, as
+    /// these are always picked up together.
+    class move_graph
+    {
+    public:
+        using node_id = std::int32_t;
+        static constexpr node_id NoNode = -1;
+        static constexpr int Slots = 4;
+
+        static int slot_of(direction_t);
+        static direction_t direction_of(int slot);
+
+        node_id add_node(std::shared_ptr<node>);
+        void set_successor(node_id from, direction_t move, node_id to, std::uint64_t coins);
+        void set_collectible_count(std::size_t);
+
+        std::size_t size() const
+        {
+            return _nodes.size();
+        }
+        static node_id root()
+        {
+            return 0;
+        }
+        node_id successor(node_id n, int slot) const
+        {
+            return _successors[static_cast<std::size_t>(n) * Slots + static_cast<std::size_t>(slot)];
+        }
+        std::uint64_t coins(node_id n, int slot) const
+        {
+            return _coins[static_cast<std::size_t>(n) * Slots + static_cast<std::size_t>(slot)];
+        }
+        bool is_exit(node_id n) const
+        {
+            return _tiles[static_cast<std::size_t>(n)] == Exit;
+        }
+        std::uint64_t all_collected() const
+        {
+            return _all_collected;
+        }
+        /// number of coin classes, which may exceed the bits of a mask
+        std::size_t collectible_count() const
+        {
+            return _collectible_count;
+        }
+        std::shared_ptr<node> const &node_at(node_id) const;
+        std::size_t edge_count() const;
+        /// bytes held by the graph's own arrays
+        std::size_t bytes() const;
+
+        /// Convert a sequence of node ids and the moves leading to them into a path.
+        path route(std::vector<node_id> const &ids, std::vector<direction_t> const &moves) const;
+        /// Replay moves from the root into a path.
+        path route(packed_route const &) const;
+
+    private:
+        std::vector<std::shared_ptr<node>> _nodes;
+        std::vector<tile_t> _tiles;
+        std::vector<node_id> _successors;
+        std::vector<std::uint64_t> _coins;
+        std::size_t _collectible_count{0};
+        std::uint64_t _all_collected{0};
+    };
+
+    /// Sequence of moves, given as `move_graph` slots, packed into two bits
+    /// each. As the graph is deterministic, the moves alone determine the
+    /// nodes of a route. Copying a route into one that has held a route at
+    /// least as long before reuses its storage, so searches that keep their
+    /// routes in this form stop allocating once they have warmed up.
+    class packed_route
+    {
+    public:
+        std::size_t size() const
+        {
+            return _size;
+        }
+        bool empty() const
+        {
+            return _size == 0;
+        }
+        int operator[](std::size_t i) const
+        {
+            return static_cast<int>((_words[i / MovesPerWord] >> (2 * (i % MovesPerWord))) & 3);
+        }
+        void push_back(int slot)
+        {
+            std::size_t const word = _size / MovesPerWord;
+            unsigned const shift = static_cast<unsigned>(2 * (_size % MovesPerWord));
+            if (word == _words.size())
+            {
+                _words.push_back(0);
+            }
+            _words[word] = (_words[word] & ~(std::uint64_t{3} << shift)) | (static_cast<std::uint64_t>(slot) << shift);
+            ++_size;
+        }
+        void pop_back()
+        {
+            --_size;
+        }
+        void clear()
+        {
+            _size = 0;
+        }
+        std::size_t bytes() const
+        {
+            return _words.capacity() * sizeof(std::uint64_t);
+        }
+
+    private:
+        static constexpr std::size_t MovesPerWord = 32;
+        std::vector<std::uint64_t> _words;
+        std::size_t _size{0};
+    };
+
+    /// Outcome of sliding from every cell into every direction.
+    ///
+    /// The table is filled in one linear sweep per row and direction and one
+    /// per column and direction, wrapping around the edges of the board like
+    /// the game does. Afterwards a slide is a single lookup.
+    class slide_table
+    {
+    public:
+        static constexpr std::int32_t NoStop = -1;
+
+        struct slide
+        {
+            /// cell index `y * width + x` where the penguin comes to rest, or
+            /// `NoStop` if nothing in the lane can stop it
+            std::int32_t stop{NoStop};
+            /// tile right behind `stop` that ended the slide
+            tile_t blocker{Rock};
+            /// range within `coins(slot)` of the collectibles crossed
+            std::uint32_t coins_begin{0};
+            std::uint32_t coins_end{0};
+        };
+
+        slide_table() = default;
+        explicit slide_table(std::vector<std::vector<tile_t>> const &level_data);
+
+        /// Redo the slides along the row and the column through (`x`, `y`)
+        /// after that tile of `level_data` has changed. The collectibles
+        /// crossed are appended anew; once more entries are stale than in
+        /// use, the whole table is rebuilt.
+        void update(std::vector<std::vector<tile_t>> const &level_data, int x, int y);
+
+        static bool is_glidable(tile_t);
+
+        /// `x` and `y` must already be normalized to the board
+        slide const &at(int x, int y, int slot) const
+        {
+            return _slides[slot][static_cast<std::size_t>(y * _width + x)];
+        }
+        std::vector<std::int32_t> const &coins(int slot) const
+        {
+            return _coins[slot];
+        }
+
+        /// Report every collectible crossed when sliding from (`x`, `y`) into
+        /// the direction of `slot` to `on_collectible` as a cell index and
+        /// return the cell index where the penguin comes to rest.
+        template <class F>
+        std::int32_t slide_from(int x, int y, int slot, tile_t &blocker, F &&on_collectible) const
+        {
+            slide const &s = at(x, y, slot);
+            for (std::uint32_t i = s.coins_begin; i < s.coins_end; ++i)
+            {
+                on_collectible(_coins[slot][i]);
+            }
+            blocker = s.blocker;
+            return s.stop;
+        }
+
+    private:
+        int _width{0};
+        int _height{0};
+        std::vector<slide> _slides[move_graph::Slots];
+        std::vector<std::int32_t> _coins[move_graph::Slots];
+        std::size_t _stale_coins{0};
+
+        void sweep_row(std::vector<std::vector<tile_t>> const &level_data, int y);
+        void sweep_column(std::vector<std::vector<tile_t>> const &level_data, int x);
+        void sweep(std::vector<tile_t> const &lane, std::vector<std::int32_t> const &cells, int step, int slot);
+    };
+
+    class bitboard;
+
+    struct coin_state
+    {
+        move_graph::node_id n;
+        std::uint64_t collected;
+
+        std::size_t operator()(coin_state const &s) const
+        {
+            return std::hash<move_graph::node_id>{}(s.n) ^ (std::hash<std::uint64_t>{}(s.collected) * 0x9e3779b97f4a7c15ULL);
+        }
+
+        bool operator==(coin_state const &o) const
+        {
+            return n == o.n && collected == o.collected;
+        }
+    };
+
+    /// Least number of moves between every pair of nodes of a move graph,
+    /// stored densely row by row (one row per origin). Built by bit-parallel
+    /// breadth-first searches that advance a batch of origins per pass.
+    class distance_matrix
+    {
+    public:
+        static constexpr std::uint16_t Unreachable = 0xffff;
+
+        distance_matrix() = default;
+        explicit distance_matrix(move_graph const &);
+
+        std::size_t size() const
+        {
+            return _size;
+        }
+        std::uint16_t operator()(move_graph::node_id from, move_graph::node_id to) const
+        {
+            return _distances[static_cast<std::size_t>(from) * _size + static_cast<std::size_t>(to)];
+        }
+
+        /// Append the node ids of a shortest walk from `from` to `to`, the
+        /// former excluded, and the moves leading to each of them. Returns
+        /// false if `to` cannot be reached.
+        bool walk(move_graph const &, move_graph::node_id from, move_graph::node_id to,
+                  std::vector<move_graph::node_id> &ids, std::vector<direction_t> &moves) const;
+
+    private:
+        std::size_t _size{0};
+        std::vector<std::uint16_t> _distances;
+    };
+
+    /// Admissible estimates of the number of moves still needed to finish a
+    /// route, derived from backward searches from the exits of a move graph.
+    class route_bounds
+    {
+    public:
+        static constexpr std::int32_t Unreachable = INT32_MAX / 4;
+
+        explicit route_bounds(move_graph const &);
+
+        /// least number of moves from `n` to any exit
+        std::int32_t to_exit(move_graph::node_id n) const
+        {
+            return _to_exit[static_cast<std::size_t>(n)];
+        }
+
+        /// least number of moves from `n` to any exit that picks up every
+        /// collectible not yet in `collected` (a lower bound, not exact)
+        std::int32_t remaining(move_graph::node_id n, std::uint64_t collected) const;
+
+        std::size_t bytes() const
+        {
+            return (_to_exit.capacity() + _via_collectible.capacity()) * sizeof(std::int32_t);
+        }
+
+    private:
+        std::size_t _collectible_count;
+        std::uint64_t _all_collected;
+        std::vector<std::int32_t> _to_exit;
+        /// least number of moves from a node to an exit via an edge that
+        /// carries a certain collectible, indexed by `node * count + bit`
+        std::vector<std::int32_t> _via_collectible;
+    };
+
+    /// Strategy of `solver::shortest_path()`. All of them find a route of
+    /// the least number of moves, but not necessarily the same one.
+    enum class path_search
+    {
+        /// breadth-first over the compiled move graph
+        breadth_first,
+        /// A* over the nodes as they are discovered, guided by how many moves
+        /// an exit is away at least: none from an exit, one from a node in
+        /// line with an exit or on a level with holes, otherwise two
+        a_star,
+        /// breadth-first from the player and, along the slide rules in
+        /// reverse, from the exits at once, always advancing the smaller
+        /// frontier until the two meet
+        bidirectional,
+        /// breadth-first over the cells of the board, one number of moves
+        /// after the other spread over threads, with a bit per cell for the
+        /// frontier and the cells seen; for boards too large to build the
+        /// move graph of
+        parallel,
+    };
+
+    /// Strongly connected components of a move graph. A route that leaves
+    /// a component never comes back to it, so every component knows which
+    /// coin classes can still be picked up from inside it, and a search can
+    /// give up on a route as soon as one it lacks is out of reach.
+    class graph_components
+    {
+    public:
+        explicit graph_components(move_graph const &);
+
+        /// number of components
+        std::size_t size() const
+        {
+            return _collectible_from.size();
+        }
+        /// components are numbered so that edges only lead to the same or a
+        /// lower number
+        std::int32_t component(move_graph::node_id n) const
+        {
+            return _component[static_cast<std::size_t>(n)];
+        }
+        /// coin classes on edges that some walk from `n` can still take
+        std::uint64_t collectible_from(move_graph::node_id n) const
+        {
+            return _collectible_from[static_cast<std::size_t>(component(n))];
+        }
+
+    private:
+        std::vector<std::int32_t> _component;
+        std::vector<std::uint64_t> _collectible_from;
+    };
+
+    struct solve_options
+    {
+        /// cut off branches that cannot end in a route shorter than the
+        /// longest one kept, using the lower bounds of `route_bounds`
+        bool prune{false};
+        /// number of worker threads; more than one switches to a parallel
+        /// search that returns the shortest routes of the
+        /// `keep_n_best_routes` shortest distinct lengths
+        std::size_t threads{1};
+        /// memory cap of a transposition table that cuts off branches
+        /// reaching a (node, collected coins) state no sooner than before;
+        /// 0 disables it. This is a heuristic: as the search follows simple
+        /// paths only, a cut may hide a route whose remainder crosses a node
+        /// of the earlier prefix, the shortest one included, and longer
+        /// lengths may be missing from the result. Once it has cut off any
+        /// branch, `solver::proven_optimal()` is false.
+        std::size_t transposition_bytes{0};
+        /// Budget of the search. Once the deadline has passed, `max_iterations`
+        /// successors have been looked at (0 for no limit) or a stop has been
+        /// requested through `stop`, `solve()` returns the routes found so
+        /// far; `solver::proven_optimal()` tells whether it got to finish.
+        std::chrono::steady_clock::time_point deadline{std::chrono::steady_clock::time_point::max()};
+        std::size_t max_iterations{0};
+        std::stop_token stop;
+        /// called with every route that is shorter than all found before it
+        /// as soon as it is found; a parallel search calls it from its
+        /// workers, one call at a time
+        std::function<void(path const &)> on_improvement;
+        /// called whenever the sequential search reaches an exit with every
+        /// coin, with the successors looked at so far and the lengths of
+        /// the routes kept, shortest first
+        std::function<void(std::size_t, std::vector<std::size_t> const &)> on_progress;
+    };
+
+    /// Counters and timings of a solver, accumulated over everything it
+    /// did since construction or the last `reset()`.
+    struct solve_stats
+    {
+        /// wall-clock time per phase in milliseconds; the solver never
+        /// parses, `parse_ms` is left to whoever read the level file
+        double parse_ms{0};
+        double graph_ms{0};
+        /// includes `backtrack_ms`, the time spent turning node ids into routes
+        double search_ms{0};
+        double backtrack_ms{0};
+        std::size_t nodes{0};
+        std::size_t edges{0};
+        /// nodes dropped from the move graph as no exit can be reached from
+        /// them, and classes the coins were merged into
+        std::size_t dead_ends{0};
+        std::size_t collectible_classes{0};
+        /// states taken up by a search, and successors it discarded because
+        /// they were visited already or could not lead to a better route
+        std::size_t states_expanded{0};
+        std::size_t states_pruned{0};
+        /// largest number of states queued (breadth-first) or stacked
+        /// (depth-first) at a time
+        std::size_t peak_frontier{0};
+        /// high-water mark of the bytes held by the graphs and the
+        /// containers of a search, estimated from their sizes
+        std::size_t peak_bytes{0};
+
+        void note_frontier(std::size_t size)
+        {
+            peak_frontier = std::max(peak_frontier, size);
+        }
+        void note_bytes(std::size_t bytes)
+        {
+            peak_bytes = std::max(peak_bytes, bytes);
+        }
+        solve_stats &operator+=(solve_stats const &);
+    };
+
+    void tag_invoke(boost::json::value_from_tag, boost::json::value &, solve_stats const &);
+
+    /// Searches the routes through one level. The level's "connections"
+    /// are not read: a hole always leads to the first other hole of the
+    /// board, read row by row. Levels with a single pair of holes are solved
+    /// as they are played; those that connect more holes differently are
+    /// not.
     class solver
     {
         static const std::vector<direction> Directions;
@@ -139,12 +572,32 @@ namespace chilly
         std::shared_ptr<node> _root;
         std::vector<coord> _holes;
         std::unordered_map<coord, int, coord> _collectibles;
+        std::unordered_map<coord, int, coord> _collectible_bits;
         std::unordered_map<coord, std::shared_ptr<node>, coord> _nodes;
+        /// nodes the backward search of `shortest_path_bidirectional()`
+        /// reached that the forward search has not, by key
+        std::unordered_map<coord, std::shared_ptr<node>, coord> _candidates;
+        std::shared_ptr<move_graph> _graph;
+        slide_table _slides;
+        std::shared_ptr<bitboard> _bitboard;
+        solve_stats _stats;
+        bool _proven_optimal{false};
         void parse_level_data();
         void unexplore_all_nodes();
         std::unordered_map<direction_t, neighbor_t> const &neighbors_of(std::shared_ptr<node> origin);
+        template <class Slider>
+        void add_neighbors(std::shared_ptr<node> const &origin, Slider const &);
+        std::shared_ptr<node> const &node_for(coord const &key, tile_t id, int x, int y);
+        /// the node stored under `key` if there is one, or else a node kept
+        /// in `_candidates` until `node_for()` adopts it
+        std::shared_ptr<node> const &candidate_for(coord const &key, tile_t id, int x, int y);
+        template <class F>
+        void predecessors_of(coord const &key, F &&visit);
+
+        std::vector<path> solve_parallel(std::size_t keep_n_best_routes, solve_options const &options);
+        std::size_t graph_bytes() const;
 
-        static path backtraced_route(std::shared_ptr<node>);
+        path backtraced_route(move_graph const &, std::vector<move_graph::node_id> const &parents, std::vector<direction_t> const &moves, move_graph::node_id);
 
     public:
         struct result
@@ -153,6 +606,9 @@ namespace chilly
             path route;
         };
 
+        /// the coin-aware searches encode collected coin classes as bits of a 64-bit word
+        static constexpr std::size_t MaxCollectibles = 64;
+
         solver(std::vector<std::vector<tile_t>> const &level_data);
         void reset();
         inline int norm_x(int x) const;
@@ -163,10 +619,32 @@ namespace chilly
         tile_t &cell(int x, int y);
 
         std::unordered_map<coord, std::shared_ptr<node>, coord> const &nodes() const;
-        
+        move_graph const &graph();
+        solve_stats const &stats() const;
+
+        /// Change a single tile and forget only what depends on it: the
+        /// moves of nodes in its row or column and the compiled graph, which
+        /// the next search rebuilds from the nodes still known. Moving the
+        /// player (by setting `Player`) or adding or removing a hole changes
+        /// where holes lead to, so it forgets all nodes. Any other tile on
+        /// the player's position removes the player.
+        void set_tile(int x, int y, tile_t tile);
+
         void collect_nodes();
-        result shortest_path();
-        std::vector<path> solve(std::size_t keep_n_best_routes);
+        /// `threads` is only used by `path_search::parallel`; 0 means one
+        /// per hardware thread
+        result shortest_path(path_search = path_search::breadth_first, std::size_t threads = 0);
+        std::vector<path> solve(std::size_t keep_n_best_routes, solve_options const &options = {});
+        /// true if the last `solve()` searched all routes, so that the
+        /// first one it returned is minimal, or that there is none; false if
+        /// it ran out of budget or its transposition table cut off a branch
+        bool proven_optimal() const;
+        result solve_exact();
+
+    private:
+        result shortest_path_a_star();
+        result shortest_path_bidirectional();
+        result shortest_path_parallel(std::size_t threads);
     };
 }
 
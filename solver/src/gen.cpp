@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boards.hpp"
+#include "chilly.hpp"
+#include "routes.hpp"
+#include "thread_pool.hpp"
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    const int DEFAULT_SIZE = 16;
+    const unsigned DEFAULT_ROCK_PERMILLE = 150;
+    const std::size_t DEFAULT_COUNT = 100;
+    const std::size_t DEFAULT_CANDIDATES_PER_LEVEL = 1000;
+    /// candidates a worker evaluates per task
+    const std::size_t CANDIDATES_PER_TASK = 16;
+    /// tasks per worker and batch; a batch is evaluated before the levels
+    /// kept are counted
+    const std::size_t TASKS_PER_THREAD = 8;
+
+    /// Closed range of acceptable values; an open end is the type's limit.
+    template <class T>
+    struct range
+    {
+        T min{std::numeric_limits<T>::lowest()};
+        T max{std::numeric_limits<T>::max()};
+
+        bool contains(T value) const
+        {
+            return min <= value && value <= max;
+        }
+    };
+
+    /// Parse "MIN:MAX", "MIN:", ":MAX" or a single value.
+    template <class T>
+    bool parse_range(std::string const &text, range<T> &r)
+    {
+        auto parse = [](std::string const &s, T &value)
+        {
+            if (s.empty())
+                return true;
+            char *end = nullptr;
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                value = static_cast<T>(std::strtod(s.c_str(), &end));
+            }
+            else
+            {
+                value = static_cast<T>(std::strtoull(s.c_str(), &end, 10));
+            }
+            return end == s.c_str() + s.size();
+        };
+        std::size_t const colon = text.find(':');
+        if (colon == std::string::npos)
+        {
+            if (!parse(text, r.min) || text.empty())
+                return false;
+            r.max = r.min;
+            return true;
+        }
+        return parse(text.substr(0, colon), r.min) && parse(text.substr(colon + 1), r.max) && r.min <= r.max;
+    }
+
+    /// What boards to make and which of them to keep.
+    struct generator_spec
+    {
+        int width{DEFAULT_SIZE};
+        int height{DEFAULT_SIZE};
+        /// rocks per thousand tiles
+        unsigned rock_permille{DEFAULT_ROCK_PERMILLE};
+        unsigned hole_pairs{0};
+        unsigned coins{0};
+        /// moves of a shortest route collecting every coin
+        range<std::size_t> moves{8, 40};
+        /// moves per stop of the move graph on average
+        range<double> branching{0, 4};
+        /// number of shortest routes collecting every coin
+        range<std::uint64_t> solutions{1, std::numeric_limits<std::uint64_t>::max()};
+        std::uint64_t seed{1};
+    };
+
+    enum class verdict
+    {
+        kept,
+        no_room,
+        no_route,
+        too_many_states,
+        moves,
+        branching,
+        solutions,
+    };
+
+    const char *const VERDICT_NAMES[] = {"kept", "no room for the tiles", "no route", "too many states",
+                                         "moves out of range", "branching out of range", "solutions out of range"};
+
+    struct candidate
+    {
+        verdict outcome{verdict::kept};
+        boost::json::object level;
+    };
+
+    /// SplitMix64 finalizer: spreads neighbouring candidate numbers over
+    /// unrelated engine seeds.
+    std::uint64_t mix(std::uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    /// Make board number `index` of the run seeded with `spec.seed` and
+    /// decide whether to keep it. The board depends on nothing else, so
+    /// any candidate can be made again on its own.
+    candidate evaluate(generator_spec const &spec, std::uint64_t index)
+    {
+        candidate result;
+        std::uint64_t const seed = mix(spec.seed + (index + 1) * 0x9e3779b97f4a7c15ULL);
+        std::optional<chilly::random_board> const board =
+            chilly::make_random_board(chilly::board_spec{spec.width, spec.height, spec.rock_permille, spec.hole_pairs, spec.coins}, seed);
+        if (!board.has_value())
+        {
+            result.outcome = verdict::no_room;
+            return result;
+        }
+        auto const &data = board->data;
+        auto const &holes = board->holes;
+
+        chilly::solver solver(data);
+        chilly::solver::result const shortest = solver.shortest_path();
+        chilly::move_graph const &graph = solver.graph();
+        if (shortest.route.empty())
+        {
+            result.outcome = verdict::no_route;
+            return result;
+        }
+        chilly::route_space const with_coins(graph, true);
+        if (!with_coins.complete())
+        {
+            result.outcome = verdict::too_many_states;
+            return result;
+        }
+        std::optional<std::size_t> const moves = with_coins.shortest_length();
+        if (!moves.has_value())
+        {
+            result.outcome = verdict::no_route;
+            return result;
+        }
+        if (!spec.moves.contains(*moves))
+        {
+            result.outcome = verdict::moves;
+            return result;
+        }
+        double const branching = static_cast<double>(graph.edge_count()) / static_cast<double>(graph.size());
+        if (!spec.branching.contains(branching))
+        {
+            result.outcome = verdict::branching;
+            return result;
+        }
+        // walks of the shortest length never pass a state twice, so they
+        // are exactly the shortest routes
+        std::uint64_t const solutions = with_coins.count_walks_by_length(*moves)[*moves];
+        if (!spec.solutions.contains(solutions))
+        {
+            result.outcome = verdict::solutions;
+            return result;
+        }
+
+        boost::json::array rows;
+        for (auto const &row : data)
+        {
+            rows.emplace_back(std::string(std::begin(row), std::end(row)));
+        }
+        std::vector<std::size_t> const thresholds = chilly::route_space(graph, false).thresholds();
+        boost::json::object &level = result.level;
+        level["name"] = "Generated " + std::to_string(spec.seed) + "/" + std::to_string(index);
+        level["creator"] = "chilly_gen";
+        // as the editor suggests them
+        level["basePoints"] = static_cast<std::int64_t>(std::lround(static_cast<double>(shortest.iterations) / 10));
+        level["thresholds"] = boost::json::array(std::begin(thresholds), std::end(thresholds));
+        level["data"] = std::move(rows);
+        boost::json::array connections;
+        if (holes.size() == 2)
+        {
+            for (int i = 0; i < 2; ++i)
+            {
+                chilly::coord const &src = holes[static_cast<std::size_t>(i)];
+                chilly::coord const &dst = holes[static_cast<std::size_t>(1 - i)];
+                connections.emplace_back(boost::json::object{{"src", boost::json::object{{"x", src.x}, {"y", src.y}}},
+                                                             {"dst", boost::json::object{{"x", dst.x}, {"y", dst.y}}}});
+            }
+        }
+        level["connections"] = std::move(connections);
+        level["solution"] = boost::json::object{{"moves", chilly::moves_of(with_coins.k_shortest(1).front())},
+                                                {"length", *moves},
+                                                {"routes", solutions},
+                                                {"branching", branching}};
+        return result;
+    }
+
+    bool parse_size(std::string const &text, int &width, int &height)
+    {
+        std::size_t const x = text.find('x');
+        width = std::atoi(text.c_str());
+        height = x == std::string::npos ? width : std::atoi(text.c_str() + x + 1);
+        return width > 0 && height > 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    generator_spec spec;
+    std::size_t count = DEFAULT_COUNT;
+    std::size_t max_candidates = 0;
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    bool usage = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool const has_value = i + 1 < argc;
+        if (arg == "--size" && has_value)
+        {
+            usage |= !parse_size(argv[++i], spec.width, spec.height);
+        }
+        else if (arg == "--rocks" && has_value)
+        {
+            spec.rock_permille = static_cast<unsigned>(std::clamp(std::atoi(argv[++i]), 0, 1000));
+        }
+        else if (arg == "--hole-pairs" && has_value)
+        {
+            spec.hole_pairs = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+            // see chilly::solver on holes
+            usage |= spec.hole_pairs > 1;
+        }
+        else if (arg == "--coins" && has_value)
+        {
+            spec.coins = static_cast<unsigned>(std::clamp(std::atoi(argv[++i]), 0, static_cast<int>(chilly::solver::MaxCollectibles)));
+        }
+        else if (arg == "--moves" && has_value)
+        {
+            usage |= !parse_range(argv[++i], spec.moves);
+        }
+        else if (arg == "--branching" && has_value)
+        {
+            usage |= !parse_range(argv[++i], spec.branching);
+        }
+        else if (arg == "--solutions" && has_value)
+        {
+            usage |= !parse_range(argv[++i], spec.solutions);
+        }
+        else if (arg == "--unique")
+        {
+            spec.solutions = range<std::uint64_t>{1, 1};
+        }
+        else if (arg == "--count" && has_value)
+        {
+            count = static_cast<std::size_t>(std::max(1LL, std::atoll(argv[++i])));
+        }
+        else if (arg == "--max-candidates" && has_value)
+        {
+            max_candidates = static_cast<std::size_t>(std::max(1LL, std::atoll(argv[++i])));
+        }
+        else if (arg == "--seed" && has_value)
+        {
+            spec.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--threads" && has_value)
+        {
+            threads = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else
+        {
+            usage = true;
+        }
+    }
+    if (max_candidates == 0)
+    {
+        max_candidates = count * DEFAULT_CANDIDATES_PER_LEVEL;
+    }
+
+    if (usage)
+    {
+        std::cerr << "\nUsage: chilly_gen [OPTIONS]\n\n"
+                  << "Generate random levels and keep those a shortest route through which,\n"
+                  << "collecting every coin, meets the given ranges. The levels are written to\n"
+                  << "stdout in the format of the level file.\n\n"
+                  << "Options:\n"
+                  << "  --size WxH             Board size, or N for NxN (default: 16)\n"
+                  << "  --rocks PERMILLE       Rocks per thousand tiles (default: 150)\n"
+                  << "  --hole-pairs N         Pairs of connected holes, 0 or 1 (default: 0)\n"
+                  << "  --coins N              Coins to collect (default: 0)\n"
+                  << "  --moves RANGE          Moves of a shortest route (default: 8:40)\n"
+                  << "  --branching RANGE      Moves per stop on average (default: 0:4)\n"
+                  << "  --solutions RANGE      Number of shortest routes (default: 1:)\n"
+                  << "  --unique               Same as --solutions 1\n"
+                  << "  --count N              Levels to keep (default: 100)\n"
+                  << "  --max-candidates N     Give up after this many boards (default: 1000\n"
+                  << "                         per level to keep)\n"
+                  << "  --seed S               Seed of the run (default: 1); the same seed and\n"
+                  << "                         options give the same levels on any number of\n"
+                  << "                         threads\n"
+                  << "  --threads N            Evaluate boards on N threads (default: all)\n\n"
+                  << "A RANGE is MIN:MAX, MIN:, :MAX or a single value.\n\n";
+        return EXIT_FAILURE;
+    }
+
+    // Candidates are evaluated in batches, and the levels kept are taken
+    // from them in candidate order, so which ones make it only depends on
+    // the seed.
+    auto const t0 = clock::now();
+    chilly::thread_pool pool(threads);
+    std::size_t const batch_size = threads * TASKS_PER_THREAD * CANDIDATES_PER_TASK;
+    boost::json::array levels;
+    std::size_t verdicts[std::size(VERDICT_NAMES)] = {};
+    std::size_t evaluated = 0;
+    std::vector<candidate> batch;
+    while (levels.size() < count && evaluated < max_candidates)
+    {
+        std::size_t const first = evaluated;
+        std::size_t const n = std::min(batch_size, max_candidates - first);
+        batch.assign(n, candidate{});
+        for (std::size_t begin = 0; begin < n; begin += CANDIDATES_PER_TASK)
+        {
+            pool.submit([&spec, &batch, first, begin, end = std::min(n, begin + CANDIDATES_PER_TASK)]()
+                        {
+                            for (std::size_t i = begin; i < end; ++i)
+                            {
+                                batch[i] = evaluate(spec, first + i);
+                            } });
+        }
+        pool.wait();
+        for (candidate &c : batch)
+        {
+            if (levels.size() == count)
+                break;
+            ++evaluated;
+            ++verdicts[static_cast<std::size_t>(c.outcome)];
+            if (c.outcome == verdict::kept)
+            {
+                levels.emplace_back(std::move(c.level));
+            }
+        }
+    }
+    double const seconds = std::chrono::duration<double>(clock::now() - t0).count();
+
+    std::cout << boost::json::serialize(levels) << std::endl;
+    std::cerr << "Kept " << levels.size() << " of " << evaluated << " boards in " << seconds << " s ("
+              << (seconds > 0 ? static_cast<double>(levels.size()) / seconds * 60 : 0.0) << " levels per minute)\n";
+    for (std::size_t i = 1; i < std::size(VERDICT_NAMES); ++i)
+    {
+        if (verdicts[i] != 0)
+        {
+            std::cerr << "  " << VERDICT_NAMES[i] << ": " << verdicts[i] << '\n';
+        }
+    }
+    if (levels.size() < count)
+    {
+        std::cerr << "Gave up after " << max_candidates << " boards.\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <memory>
+#include <numeric>
+#include <queue>
+
+#include "ida.hpp"
+
+namespace chilly
+{
+    namespace
+    {
+        const std::size_t ClockInterval = 1024;
+
+        /// A state on the stack of the depth-first search, with the next
+        /// move slot to try from it
+        struct frame
+        {
+            std::uint64_t collected;
+            move_graph::node_id node;
+            /// estimated length of a route through this state
+            std::int32_t estimate;
+            int slot;
+        };
+
+        /// Shortest prefix per state (stop, coins collected) seen in the
+        /// current round, in a table of fixed size. Entries hold the full
+        /// state, not just a hash of it, so a branch is never cut off for a
+        /// state it did not reach. They come in buckets of four that share a
+        /// cache line; a new state evicts an entry of an earlier round or
+        /// else the one reached with the longest prefix.
+        class prefix_cache
+        {
+        public:
+            explicit prefix_cache(std::size_t max_bytes)
+            {
+                std::size_t const buckets = std::bit_floor(std::max<std::size_t>(max_bytes / sizeof(bucket), 1));
+                _mask = buckets - 1;
+                _buckets = std::make_unique<bucket[]>(buckets);
+            }
+
+            /// Return true if the state was reached in `round` before with a
+            /// prefix no longer than `length`; otherwise remember `length`.
+            bool seen(move_graph::node_id n, std::uint64_t collected, std::uint16_t length, std::uint16_t round)
+            {
+                bucket &b = _buckets[hash(n, collected) & _mask];
+                entry *victim = nullptr;
+                for (entry &e : b.entries)
+                {
+                    if (e.round != 0 && e.node == n && e.collected == collected)
+                    {
+                        if (e.round == round && e.length <= length)
+                            return true;
+                        e.length = length;
+                        e.round = round;
+                        return false;
+                    }
+                    if (victim == nullptr || rank(e, round) > rank(*victim, round))
+                    {
+                        victim = &e;
+                    }
+                }
+                *victim = entry{collected, n, length, round};
+                return false;
+            }
+
+            std::size_t bytes() const
+            {
+                return (_mask + 1) * sizeof(bucket);
+            }
+            /// size of the smallest cache
+            static std::size_t min_bytes()
+            {
+                return sizeof(bucket);
+            }
+
+        private:
+            struct entry
+            {
+                std::uint64_t collected{0};
+                move_graph::node_id node{move_graph::NoNode};
+                std::uint16_t length{0};
+                /// 0 for an empty entry
+                std::uint16_t round{0};
+            };
+            struct alignas(64) bucket
+            {
+                std::array<entry, 4> entries;
+            };
+
+            std::unique_ptr<bucket[]> _buckets;
+            std::size_t _mask{0};
+
+            static std::uint32_t rank(entry const &e, std::uint16_t round)
+            {
+                return e.round != round ? UINT32_MAX : e.length;
+            }
+
+            static std::size_t hash(move_graph::node_id n, std::uint64_t collected)
+            {
+                // SplitMix64 finalizer
+                std::uint64_t z = collected ^ (static_cast<std::uint64_t>(n) * 0x9e3779b97f4a7c15ULL);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                return static_cast<std::size_t>(z ^ (z >> 31));
+            }
+        };
+    }
+
+    ida_solver::ida_solver(move_graph const &g, std::size_t max_bytes)
+        : _graph(g),
+          _collectible_count(static_cast<std::size_t>(std::popcount(g.all_collected()))),
+          _bounds(g),
+          _to_coin(g.size() * _collectible_count, route_bounds::Unreachable),
+          _between(_collectible_count * _collectible_count, route_bounds::Unreachable),
+          _coin_to_exit(_collectible_count, route_bounds::Unreachable)
+    {
+        std::size_t const k = _collectible_count;
+        move_graph::node_id const count = static_cast<move_graph::node_id>(g.size());
+
+        // predecessor lists in compressed sparse row layout
+        std::vector<std::size_t> first(g.size() + 1, 0);
+        for (move_graph::node_id n = 0; n < count; ++n)
+        {
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                if (g.successor(n, slot) != move_graph::NoNode)
+                {
+                    ++first[static_cast<std::size_t>(g.successor(n, slot)) + 1];
+                }
+            }
+        }
+        std::partial_sum(std::begin(first), std::end(first), std::begin(first));
+        std::vector<move_graph::node_id> predecessors(first.back());
+        std::vector<std::size_t> fill(std::begin(first), std::end(first) - 1);
+        for (move_graph::node_id n = 0; n < count; ++n)
+        {
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                if (g.successor(n, slot) != move_graph::NoNode)
+                {
+                    predecessors[fill[static_cast<std::size_t>(g.successor(n, slot))]++] = n;
+                }
+            }
+        }
+
+        // breadth-first backwards from the tails of the edges that carry a
+        // coin class, each one move away from picking it up
+        for (std::size_t bit = 0; bit < k; ++bit)
+        {
+            auto dist = [this, k, bit](move_graph::node_id n) -> std::int32_t &
+            {
+                return _to_coin[static_cast<std::size_t>(n) * k + bit];
+            };
+            std::queue<move_graph::node_id> q;
+            for (move_graph::node_id n = 0; n < count; ++n)
+            {
+                for (int slot = 0; slot < move_graph::Slots; ++slot)
+                {
+                    if (g.successor(n, slot) != move_graph::NoNode && (g.coins(n, slot) & (std::uint64_t{1} << bit)) != 0 &&
+                        dist(n) == route_bounds::Unreachable)
+                    {
+                        dist(n) = 1;
+                        q.push(n);
+                    }
+                }
+            }
+            while (!q.empty())
+            {
+                move_graph::node_id const current = q.front();
+                q.pop();
+                for (std::size_t i = first[static_cast<std::size_t>(current)]; i < first[static_cast<std::size_t>(current) + 1]; ++i)
+                {
+                    if (dist(predecessors[i]) == route_bounds::Unreachable)
+                    {
+                        dist(predecessors[i]) = dist(current) + 1;
+                        q.push(predecessors[i]);
+                    }
+                }
+            }
+        }
+
+        // from the head of an edge that picks up one coin class on to the
+        // next class or an exit; an edge that carries both costs nothing
+        for (move_graph::node_id n = 0; n < count; ++n)
+        {
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                move_graph::node_id const next = g.successor(n, slot);
+                std::uint64_t const coins = next == move_graph::NoNode ? 0 : g.coins(n, slot);
+                for (std::uint64_t from = coins; from != 0; from &= from - 1)
+                {
+                    std::size_t const a = static_cast<std::size_t>(std::countr_zero(from));
+                    _coin_to_exit[a] = std::min(_coin_to_exit[a], _bounds.to_exit(next));
+                    for (std::size_t b = 0; b < k; ++b)
+                    {
+                        std::int32_t const d = (coins & (std::uint64_t{1} << b)) != 0 ? 0 : _to_coin[static_cast<std::size_t>(next) * k + b];
+                        _between[a * k + b] = std::min(_between[a * k + b], d);
+                    }
+                }
+            }
+        }
+        for (std::size_t a = 0; a < k; ++a)
+        {
+            for (std::size_t b = a + 1; b < k; ++b)
+            {
+                _between[a * k + b] = _between[b * k + a] = std::min(_between[a * k + b], _between[b * k + a]);
+            }
+        }
+
+        // the stack is reserved in full, so the cache gets what is left
+        _bytes = g.bytes() + _bounds.bytes() +
+                 (_to_coin.capacity() + _between.capacity() + _coin_to_exit.capacity()) * sizeof(std::int32_t) +
+                 (MaxLength + 2) * sizeof(frame);
+        _cache_bytes = max_bytes > _bytes ? max_bytes - _bytes : 0;
+    }
+
+    std::int32_t ida_solver::spanning_tree(move_graph::node_id n, std::uint64_t collected) const
+    {
+        std::uint64_t const missing = _graph.all_collected() & ~collected;
+        if (missing == 0)
+            return _bounds.to_exit(n);
+
+        // Prim's algorithm over the missing coin classes and, last, the
+        // exits, growing the tree from the stop
+        std::size_t const k = _collectible_count;
+        std::array<std::size_t, solver::MaxCollectibles> coins;
+        std::size_t m = 0;
+        for (std::uint64_t rest = missing; rest != 0; rest &= rest - 1)
+        {
+            coins[m++] = static_cast<std::size_t>(std::countr_zero(rest));
+        }
+        std::array<std::int32_t, solver::MaxCollectibles + 1> distance;
+        std::array<bool, solver::MaxCollectibles + 1> in_tree{};
+        for (std::size_t i = 0; i < m; ++i)
+        {
+            distance[i] = _to_coin[static_cast<std::size_t>(n) * k + coins[i]];
+        }
+        distance[m] = _bounds.to_exit(n);
+        std::int32_t weight = 0;
+        for (std::size_t added = 0; added <= m; ++added)
+        {
+            std::size_t nearest = m + 1;
+            for (std::size_t i = 0; i <= m; ++i)
+            {
+                if (!in_tree[i] && (nearest > m || distance[i] < distance[nearest]))
+                {
+                    nearest = i;
+                }
+            }
+            if (distance[nearest] >= route_bounds::Unreachable)
+                return route_bounds::Unreachable;
+            weight += distance[nearest];
+            in_tree[nearest] = true;
+            for (std::size_t i = 0; i < m; ++i)
+            {
+                if (in_tree[i])
+                    continue;
+                std::int32_t const d = nearest == m ? _coin_to_exit[coins[i]] : _between[coins[nearest] * k + coins[i]];
+                distance[i] = std::min(distance[i], d);
+            }
+            if (nearest < m && !in_tree[m])
+            {
+                distance[m] = std::min(distance[m], _coin_to_exit[coins[nearest]]);
+            }
+        }
+        return weight;
+    }
+
+    std::int32_t ida_solver::lower_bound(move_graph::node_id n, std::uint64_t collected) const
+    {
+        std::int32_t const bound = _bounds.remaining(n, collected);
+        if (bound >= route_bounds::Unreachable)
+            return route_bounds::Unreachable;
+        return std::max(bound, spanning_tree(n, collected));
+    }
+
+    ida_solver::result ida_solver::solve(clock::time_point deadline) const
+    {
+        result res;
+        if (_graph.size() == 0 || _graph.collectible_count() > solver::MaxCollectibles)
+            return res;
+        res.bytes = _bytes;
+        if (_cache_bytes < prefix_cache::min_bytes())
+        {
+            res.out_of_memory = true;
+            return res;
+        }
+        prefix_cache cache(_cache_bytes);
+        res.bytes += cache.bytes();
+        std::vector<frame> frames;
+        frames.reserve(MaxLength + 2);
+
+        std::int32_t threshold = lower_bound(move_graph::root(), 0);
+        std::int32_t next_threshold = route_bounds::Unreachable;
+        std::uint16_t round = 0;
+        // Push a state if it may lie on a route within the threshold, and
+        // return true if it ends one. `estimate` is that of its predecessor.
+        auto enter = [this, &res, &frames, &cache, &threshold, &next_threshold, &round](move_graph::node_id n, std::uint64_t collected, std::int32_t length, std::int32_t estimate)
+        {
+            std::int32_t const bound = lower_bound(n, collected);
+            if (bound >= route_bounds::Unreachable)
+            {
+                ++res.states_pruned;
+                return false;
+            }
+            estimate = std::max(estimate, length + bound);
+            if (estimate > threshold)
+            {
+                next_threshold = std::min(next_threshold, estimate);
+                return false;
+            }
+            if (_graph.is_exit(n))
+                return collected == _graph.all_collected();
+            if (cache.seen(n, collected, static_cast<std::uint16_t>(length), round))
+            {
+                ++res.states_pruned;
+                return false;
+            }
+            ++res.states_expanded;
+            frames.push_back(frame{collected, n, estimate, 0});
+            return false;
+        };
+
+        // every round raises the threshold, so there are fewer rounds than
+        // the 16 bits of `round` count
+        while (threshold < route_bounds::Unreachable && threshold <= static_cast<std::int32_t>(MaxLength))
+        {
+            ++round;
+            ++res.rounds;
+            next_threshold = route_bounds::Unreachable;
+            bool found = enter(move_graph::root(), 0, 0, 0);
+            while (!found && !frames.empty())
+            {
+                frame &top = frames.back();
+                if (top.slot == move_graph::Slots)
+                {
+                    frames.pop_back();
+                    continue;
+                }
+                int const slot = top.slot++;
+                move_graph::node_id const next = _graph.successor(top.node, slot);
+                if (next == move_graph::NoNode)
+                    continue;
+                if (++res.iterations % ClockInterval == 0 && clock::now() >= deadline)
+                {
+                    res.timed_out = true;
+                    return res;
+                }
+                found = enter(next, top.collected | _graph.coins(top.node, slot), static_cast<std::int32_t>(frames.size()), top.estimate);
+            }
+            if (found)
+            {
+                // every state on the stack has moved on past the slot that
+                // leads to the next one
+                packed_route route;
+                for (frame const &f : frames)
+                {
+                    route.push_back(f.slot - 1);
+                }
+                res.route = _graph.route(route);
+                res.optimal = true;
+                return res;
+            }
+            threshold = next_threshold;
+        }
+        // no route at all, unless it would be longer than `MaxLength`
+        res.optimal = threshold >= route_bounds::Unreachable;
+        return res;
+    }
+}
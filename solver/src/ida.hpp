@@ -0,0 +1,93 @@
+#ifndef __IDA_HPP__
+#define __IDA_HPP__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chilly.hpp"
+
+namespace chilly
+{
+    /// Shortest route that picks up every collectible and then leaves through
+    /// an exit, found by iterative-deepening A* over the states (stop, coins
+    /// collected) within a fixed memory budget.
+    ///
+    /// Each round is a depth-first search that gives up on a branch as soon
+    /// as its length plus a lower bound of the moves still needed exceeds the
+    /// round's threshold; the next round raises the threshold to the least
+    /// estimate that exceeded it. The lower bound is the larger of
+    /// `route_bounds::remaining()` and the weight of a minimum spanning tree
+    /// over the stop, the coin classes still missing and the exits, whose
+    /// edges are weighted with the least number of moves between them in
+    /// either direction. The rest of every route is a path through all of
+    /// these, so it takes at least as many moves. Estimates never decrease
+    /// along a branch (pathmax).
+    ///
+    /// Unlike `solver::solve_exact()`, the search does not remember every
+    /// state it has seen. A cache of fixed size keeps the shortest prefix
+    /// per state of the current round and cuts off branches reaching a state
+    /// no sooner than before. A state evicted from the cache is merely
+    /// searched again, so the route found is minimal whatever the size of
+    /// the cache.
+    class ida_solver
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        struct result
+        {
+            path route;
+            /// true if `route` is provably minimal or, if it is empty, that
+            /// no route collects every coin
+            bool optimal{false};
+            /// moves looked at, over all rounds
+            std::size_t iterations{0};
+            std::size_t rounds{0};
+            /// states taken up, and those cut off by the cache or for a coin
+            /// out of reach
+            std::size_t states_expanded{0};
+            std::size_t states_pruned{0};
+            /// bytes held by the graph, the bounds, the stack and the cache
+            std::size_t bytes{0};
+            /// true if the deadline cut the search short
+            bool timed_out{false};
+            /// true if the graph and the bounds alone exceed the memory cap
+            bool out_of_memory{false};
+        };
+
+        /// longest route looked for; the stack is reserved for it up front
+        static constexpr std::uint32_t MaxLength = 4094;
+
+        /// Prepare a search of `g` whose memory, the graph's arrays
+        /// included, stays within `max_bytes`; whatever the bounds and the
+        /// stack leave of it goes to the cache. The cap leaves out the
+        /// `solver` that owns `g` and the predecessor lists and queues the
+        /// constructor computes the bounds with, which are released before
+        /// `solve()`.
+        ida_solver(move_graph const &g, std::size_t max_bytes);
+
+        result solve(clock::time_point deadline = clock::time_point::max()) const;
+
+    private:
+        move_graph const &_graph;
+        std::size_t _collectible_count;
+        route_bounds _bounds;
+        /// least number of moves from a node through an edge that carries a
+        /// certain coin class, indexed by `node * count + bit`
+        std::vector<std::int32_t> _to_coin;
+        /// least number of moves from picking up one coin class to picking
+        /// up another, in either direction, indexed by `bit * count + bit`
+        std::vector<std::int32_t> _between;
+        /// least number of moves from picking up a coin class to an exit
+        std::vector<std::int32_t> _coin_to_exit;
+        std::size_t _bytes{0};
+        std::size_t _cache_bytes{0};
+
+        std::int32_t spanning_tree(move_graph::node_id n, std::uint64_t collected) const;
+        std::int32_t lower_bound(move_graph::node_id n, std::uint64_t collected) const;
+    };
+}
+
+#endif // __IDA_HPP__
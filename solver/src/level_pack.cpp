@@ -0,0 +1,407 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#include "level_pack.hpp"
+
+namespace chilly
+{
+    namespace
+    {
+        const char Magic[8] = {'C', 'H', 'I', 'L', 'L', 'Y', 'P', 'K'};
+        const std::uint32_t Version = 2;
+        const std::uint32_t ByteOrderMark = 0x01020304;
+
+        struct file_header
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t byte_order;
+            std::uint64_t count;
+        };
+
+        struct offsets_entry
+        {
+            std::uint64_t hash;
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+
+        enum record_flags : std::uint32_t
+        {
+            ShortestFound = 1,
+            CoinsFound = 2,
+            CoinsOptimal = 4,
+            CoinsTimedOut = 8,
+        };
+
+        struct record_header
+        {
+            std::uint32_t width;
+            std::uint32_t height;
+            std::uint32_t node_count;
+            std::uint32_t edge_count;
+            std::uint32_t collectible_count;
+            std::uint32_t flags;
+            std::uint32_t name_length;
+            std::uint32_t shortest_length;
+            std::uint32_t coins_length;
+            std::uint32_t threshold_count;
+            std::uint32_t walk_count_length;
+            std::uint32_t reserved;
+            std::uint64_t shortest_iterations;
+            std::uint64_t coins_iterations;
+        };
+
+        std::size_t aligned(std::size_t n)
+        {
+            return (n + 7) & ~std::size_t{7};
+        }
+
+        /// Where the sections of a record start, relative to the record.
+        struct record_layout
+        {
+            std::size_t tiles;
+            std::size_t first_edge;
+            std::size_t nodes;
+            std::size_t edges;
+            std::size_t thresholds;
+            std::size_t walk_counts;
+            std::size_t name;
+            std::size_t shortest;
+            std::size_t coins;
+            std::size_t size;
+
+            explicit record_layout(record_header const &h)
+            {
+                tiles = sizeof(record_header);
+                first_edge = tiles + aligned(std::size_t{h.width} * h.height);
+                nodes = first_edge + aligned((std::size_t{h.node_count} + 1) * sizeof(std::uint32_t));
+                edges = nodes + std::size_t{h.node_count} * sizeof(level_pack::packed_node);
+                thresholds = edges + std::size_t{h.edge_count} * sizeof(level_pack::packed_edge);
+                walk_counts = thresholds + std::size_t{h.threshold_count} * sizeof(std::uint64_t);
+                name = walk_counts + std::size_t{h.walk_count_length} * sizeof(std::uint64_t);
+                shortest = name + h.name_length;
+                coins = shortest + h.shortest_length;
+                size = aligned(coins + h.coins_length);
+            }
+        };
+
+        std::size_t header_bytes(std::size_t count)
+        {
+            return sizeof(file_header) + count * sizeof(offsets_entry) + aligned(count * sizeof(std::uint32_t));
+        }
+
+        template <class T>
+        void append(std::string &out, T const &value)
+        {
+            out.append(reinterpret_cast<char const *>(&value), sizeof(T));
+        }
+
+        void pad(std::string &out)
+        {
+            out.resize(aligned(out.size()), '\0');
+        }
+    }
+
+    std::uint64_t content_hash(std::vector<std::vector<tile_t>> const &data)
+    {
+        std::uint64_t hash = 0xcbf29ce484222325ULL;
+        auto mix = [&hash](std::uint8_t byte)
+        {
+            hash = (hash ^ byte) * 0x100000001b3ULL;
+        };
+        std::uint32_t const dimensions[] = {static_cast<std::uint32_t>(data.empty() ? 0 : data.front().size()),
+                                            static_cast<std::uint32_t>(data.size())};
+        for (std::uint32_t d : dimensions)
+        {
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                mix(static_cast<std::uint8_t>(d >> shift));
+            }
+        }
+        for (auto const &row : data)
+        {
+            for (tile_t tile : row)
+            {
+                mix(static_cast<std::uint8_t>(tile));
+            }
+        }
+        return hash;
+    }
+
+    level_pack::level_pack(std::string const &path)
+        : _file(path)
+    {
+        _data = _file.data();
+        _size = _file.size();
+        if (_data != nullptr && !valid())
+        {
+            _data = nullptr;
+            _size = 0;
+        }
+    }
+
+    bool level_pack::valid()
+    {
+        if (_size < sizeof(file_header))
+            return false;
+        file_header header;
+        std::memcpy(&header, _data, sizeof(header));
+        if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || header.byte_order != ByteOrderMark)
+            return false;
+        if (header.count > (_size - sizeof(file_header)) / sizeof(offsets_entry) || header_bytes(header.count) > _size)
+            return false;
+        auto const *offsets = reinterpret_cast<offsets_entry const *>(_data + sizeof(file_header));
+        auto const *by_hash = reinterpret_cast<std::uint32_t const *>(offsets + header.count);
+        for (std::size_t i = 0; i < header.count; ++i)
+        {
+            offsets_entry const &o = offsets[i];
+            if (o.offset % 8 != 0 || o.offset < header_bytes(header.count) || o.size < sizeof(record_header) ||
+                o.offset > _size || o.size > _size - o.offset || by_hash[i] >= header.count)
+                return false;
+            record_header h;
+            std::memcpy(&h, _data + o.offset, sizeof(h));
+            if (record_layout(h).size > o.size)
+                return false;
+        }
+        _count = header.count;
+        return true;
+    }
+
+    level_pack::entry level_pack::at(std::size_t i) const
+    {
+        auto const *offsets = reinterpret_cast<offsets_entry const *>(_data + sizeof(file_header));
+        char const *base = _data + offsets[i].offset;
+        auto const &h = *reinterpret_cast<record_header const *>(base);
+        record_layout const layout(h);
+        entry e;
+        e.hash = offsets[i].hash;
+        e.name = std::string_view(base + layout.name, h.name_length);
+        e.width = static_cast<int>(h.width);
+        e.height = static_cast<int>(h.height);
+        e.tiles = std::string_view(base + layout.tiles, std::size_t{h.width} * h.height);
+        e.collectible_count = h.collectible_count;
+        e.first_edge = std::span(reinterpret_cast<std::uint32_t const *>(base + layout.first_edge), std::size_t{h.node_count} + 1);
+        e.nodes = std::span(reinterpret_cast<packed_node const *>(base + layout.nodes), h.node_count);
+        e.edges = std::span(reinterpret_cast<packed_edge const *>(base + layout.edges), h.edge_count);
+        e.shortest = cached_route{(h.flags & ShortestFound) != 0, std::string_view(base + layout.shortest, h.shortest_length), h.shortest_iterations};
+        e.coins = cached_route{(h.flags & CoinsFound) != 0, std::string_view(base + layout.coins, h.coins_length), h.coins_iterations};
+        e.coins_optimal = (h.flags & CoinsOptimal) != 0;
+        e.coins_timed_out = (h.flags & CoinsTimedOut) != 0;
+        e.thresholds = std::span(reinterpret_cast<std::uint64_t const *>(base + layout.thresholds), h.threshold_count);
+        e.walk_counts = std::span(reinterpret_cast<std::uint64_t const *>(base + layout.walk_counts), h.walk_count_length);
+        e.record = std::string_view(base, offsets[i].size);
+        return e;
+    }
+
+    bool level_pack::entry::matches(std::vector<std::vector<tile_t>> const &data) const
+    {
+        if (static_cast<std::size_t>(height) != data.size() || static_cast<std::size_t>(width) * data.size() != tiles.size())
+            return false;
+        std::size_t i = 0;
+        for (auto const &row : data)
+        {
+            if (row.size() != static_cast<std::size_t>(width))
+                return false;
+            for (tile_t tile : row)
+            {
+                if (tiles[i++] != static_cast<char>(tile))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    std::optional<level_pack::entry> level_pack::find(std::uint64_t hash) const
+    {
+        if (_count == 0)
+            return std::nullopt;
+        auto const *offsets = reinterpret_cast<offsets_entry const *>(_data + sizeof(file_header));
+        auto const *by_hash = reinterpret_cast<std::uint32_t const *>(offsets + _count);
+        auto const it = std::lower_bound(by_hash, by_hash + _count, hash, [offsets](std::uint32_t i, std::uint64_t h)
+                                         { return offsets[i].hash < h; });
+        if (it == by_hash + _count || offsets[*it].hash != hash)
+            return std::nullopt;
+        return at(*it);
+    }
+
+    move_graph level_pack::graph(entry const &e)
+    {
+        move_graph g;
+        for (auto const &n : e.nodes)
+        {
+            g.add_node(std::make_shared<node>(static_cast<tile_t>(n.tile), n.x, n.y));
+        }
+        for (std::size_t n = 0; n < e.node_count(); ++n)
+        {
+            for (std::uint32_t i = e.first_edge[n]; i < e.first_edge[n + 1] && i < e.edges.size(); ++i)
+            {
+                auto const &edge = e.edges[i];
+                if (edge.target < 0 || static_cast<std::size_t>(edge.target) >= e.node_count() || edge.slot >= move_graph::Slots)
+                    continue;
+                g.set_successor(static_cast<move_graph::node_id>(n), move_graph::direction_of(static_cast<int>(edge.slot)),
+                                edge.target, edge.coins);
+            }
+        }
+        g.set_collectible_count(e.collectible_count);
+        return g;
+    }
+
+    void level_pack_writer::store(std::size_t index, record r)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (index >= _records.size())
+        {
+            _records.resize(index + 1);
+        }
+        _records[index] = std::move(r);
+    }
+
+    void level_pack_writer::set(std::size_t index, std::string const &name, std::vector<std::vector<tile_t>> const &data,
+                                move_graph const &graph, solver::result const &shortest, tour_solver::result const &coins,
+                                std::vector<std::size_t> const &thresholds, std::vector<std::uint64_t> const &walk_counts)
+    {
+        std::size_t const first_length = thresholds.empty() ? walk_counts.size() : std::min(thresholds.front(), walk_counts.size());
+        std::string const shortest_moves = moves_of(shortest.route);
+        std::string const coin_moves = moves_of(coins.route);
+        record_header h{};
+        h.width = static_cast<std::uint32_t>(data.empty() ? 0 : data.front().size());
+        h.height = static_cast<std::uint32_t>(data.size());
+        h.node_count = static_cast<std::uint32_t>(graph.size());
+        h.edge_count = static_cast<std::uint32_t>(graph.edge_count());
+        h.collectible_count = static_cast<std::uint32_t>(graph.collectible_count());
+        h.flags = (shortest.route.empty() ? 0 : ShortestFound) | (coins.route.empty() ? 0 : CoinsFound) |
+                  (coins.optimal ? CoinsOptimal : 0) | (coins.timed_out ? CoinsTimedOut : 0);
+        h.name_length = static_cast<std::uint32_t>(name.size());
+        h.shortest_length = static_cast<std::uint32_t>(shortest_moves.size());
+        h.coins_length = static_cast<std::uint32_t>(coin_moves.size());
+        h.threshold_count = static_cast<std::uint32_t>(thresholds.size());
+        h.walk_count_length = static_cast<std::uint32_t>(walk_counts.size() - first_length);
+        h.shortest_iterations = shortest.iterations;
+        h.coins_iterations = coins.iterations;
+
+        std::string out;
+        out.reserve(record_layout(h).size);
+        append(out, h);
+        for (auto const &row : data)
+        {
+            for (tile_t tile : row)
+            {
+                out.push_back(static_cast<char>(tile));
+            }
+        }
+        pad(out);
+        std::uint32_t edges = 0;
+        for (std::size_t n = 0; n < graph.size(); ++n)
+        {
+            append(out, edges);
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                edges += graph.successor(static_cast<move_graph::node_id>(n), slot) != move_graph::NoNode;
+            }
+        }
+        append(out, edges);
+        pad(out);
+        for (std::size_t n = 0; n < graph.size(); ++n)
+        {
+            auto const &nd = graph.node_at(static_cast<move_graph::node_id>(n));
+            append(out, level_pack::packed_node{nd->x(), nd->y(), static_cast<std::uint32_t>(nd->id()), 0});
+        }
+        for (std::size_t n = 0; n < graph.size(); ++n)
+        {
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                move_graph::node_id const to = graph.successor(static_cast<move_graph::node_id>(n), slot);
+                if (to != move_graph::NoNode)
+                {
+                    append(out, level_pack::packed_edge{to, static_cast<std::uint32_t>(slot),
+                                                        graph.coins(static_cast<move_graph::node_id>(n), slot)});
+                }
+            }
+        }
+        for (std::size_t t : thresholds)
+        {
+            append(out, static_cast<std::uint64_t>(t));
+        }
+        for (std::size_t length = first_length; length < walk_counts.size(); ++length)
+        {
+            append(out, walk_counts[length]);
+        }
+        out += name;
+        out += shortest_moves;
+        out += coin_moves;
+        pad(out);
+        store(index, record{content_hash(data), std::move(out)});
+    }
+
+    void level_pack_writer::set(std::size_t index, level_pack::entry const &e)
+    {
+        store(index, record{e.hash, std::string(e.record)});
+    }
+
+    bool level_pack_writer::write(std::string const &path) const
+    {
+        // levels never set could not be solved and are left out
+        std::vector<record const *> records;
+        for (auto const &r : _records)
+        {
+            if (!r.bytes.empty())
+            {
+                records.push_back(&r);
+            }
+        }
+        std::size_t const count = records.size();
+        std::vector<std::uint32_t> by_hash(count);
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            by_hash[i] = i;
+        }
+        std::stable_sort(std::begin(by_hash), std::end(by_hash), [&records](std::uint32_t a, std::uint32_t b)
+                         { return records[a]->hash < records[b]->hash; });
+
+        std::string header;
+        file_header fh{};
+        std::memcpy(fh.magic, Magic, sizeof(Magic));
+        fh.version = Version;
+        fh.byte_order = ByteOrderMark;
+        fh.count = count;
+        append(header, fh);
+        std::uint64_t offset = header_bytes(count);
+        for (auto const *r : records)
+        {
+            append(header, offsets_entry{r->hash, offset, r->bytes.size()});
+            offset += r->bytes.size();
+        }
+        for (std::uint32_t i : by_hash)
+        {
+            append(header, i);
+        }
+        pad(header);
+
+        std::string const temporary = path + ".tmp";
+        {
+            std::ofstream ofs(temporary, std::ios::binary | std::ios::trunc);
+            ofs.write(header.data(), static_cast<std::streamsize>(header.size()));
+            for (auto const *r : records)
+            {
+                ofs.write(r->bytes.data(), static_cast<std::streamsize>(r->bytes.size()));
+            }
+            // closing flushes, which may fail as well
+            ofs.close();
+            if (!ofs)
+            {
+                std::remove(temporary.c_str());
+                return false;
+            }
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporary.c_str());
+            return false;
+        }
+        return true;
+    }
+}
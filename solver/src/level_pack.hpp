@@ -0,0 +1,157 @@
+#ifndef __LEVEL_PACK_HPP__
+#define __LEVEL_PACK_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chilly.hpp"
+#include "mapped_file.hpp"
+#include "tour.hpp"
+
+namespace chilly
+{
+    /// FNV-1a hash of a board's size and tiles, which identifies a level in
+    /// a pack whatever its name or position in the level file.
+    std::uint64_t content_hash(std::vector<std::vector<tile_t>> const &data);
+
+    /// Read-only view of a level pack: a binary file with the boards of a
+    /// level file and what solving them found, laid out so that it can be
+    /// mapped into memory and used in place.
+    ///
+    /// A header is followed by an offsets table with the hash, offset and
+    /// size of every level's record in level order, and by the level
+    /// numbers sorted by hash for lookups. A record holds the board, one
+    /// byte per tile, the compiled move graph as compressed sparse rows
+    /// (the first edge of every node, then target, move slot and coins per
+    /// edge), the star thresholds and walk counts per length of the batch
+    /// report, and the routes found with their search counters. Everything is
+    /// aligned to eight bytes and in the byte order of the machine that
+    /// wrote it; a file of another version or byte order is not opened.
+    class level_pack
+    {
+    public:
+        struct packed_node
+        {
+            std::int32_t x;
+            std::int32_t y;
+            std::uint32_t tile;
+            std::uint32_t reserved;
+        };
+
+        struct packed_edge
+        {
+            move_graph::node_id target;
+            std::uint32_t slot;
+            std::uint64_t coins;
+        };
+
+        struct cached_route
+        {
+            bool found{false};
+            std::string_view moves;
+            std::uint64_t iterations{0};
+        };
+
+        /// One level of the pack; views into the mapped file.
+        struct entry
+        {
+            std::uint64_t hash{0};
+            std::string_view name;
+            int width{0};
+            int height{0};
+            /// row-major tiles
+            std::string_view tiles;
+            std::uint32_t collectible_count{0};
+            /// `node_count() + 1` offsets into `edges`
+            std::span<std::uint32_t const> first_edge;
+            std::span<packed_node const> nodes;
+            std::span<packed_edge const> edges;
+            cached_route shortest;
+            cached_route coins;
+            bool coins_optimal{false};
+            bool coins_timed_out{false};
+            /// star thresholds from the lengths of all walks, if any
+            std::span<std::uint64_t const> thresholds;
+            /// number of walks per length, from `thresholds.front()` on
+            std::span<std::uint64_t const> walk_counts;
+            /// the whole record, for copying it into a new pack unchanged
+            std::string_view record;
+
+            std::size_t node_count() const
+            {
+                return nodes.size();
+            }
+            /// true if the record holds exactly this board, not just one
+            /// with the same hash
+            bool matches(std::vector<std::vector<tile_t>> const &data) const;
+        };
+
+        /// Map the pack at `path`. A missing or unreadable file leaves an
+        /// empty pack, so callers fall back to solving every level.
+        explicit level_pack(std::string const &path);
+
+        bool is_open() const
+        {
+            return _data != nullptr;
+        }
+        std::size_t size() const
+        {
+            return _count;
+        }
+        /// level `i` in the order of the level file the pack was made from
+        entry at(std::size_t i) const;
+        /// the level with the board hashed to `hash`, if any
+        std::optional<entry> find(std::uint64_t hash) const;
+
+        /// Rebuild the searchable graph of an entry.
+        static move_graph graph(entry const &);
+
+    private:
+        mapped_file _file;
+        /// the file's contents, if it is a valid pack
+        char const *_data{nullptr};
+        std::size_t _size{0};
+        std::size_t _count{0};
+
+        bool valid();
+    };
+
+    /// Collects the records of a new level pack, one per level of a level
+    /// file, and writes them out in one go. Levels may be set from
+    /// different threads and in any order; the pack grows to hold the
+    /// highest index set.
+    class level_pack_writer
+    {
+    public:
+        /// `walk_counts` holds the number of walks per length from 0 on,
+        /// of which those from `thresholds.front()` on are kept
+        void set(std::size_t index, std::string const &name, std::vector<std::vector<tile_t>> const &data,
+                 move_graph const &graph, solver::result const &shortest, tour_solver::result const &coins,
+                 std::vector<std::size_t> const &thresholds, std::vector<std::uint64_t> const &walk_counts);
+        /// keep a level whose board has not changed
+        void set(std::size_t index, level_pack::entry const &);
+
+        /// Write all levels set, replacing `path` only once the new pack is
+        /// complete, so that a pack still mapped stays intact until then.
+        bool write(std::string const &path) const;
+
+    private:
+        struct record
+        {
+            std::uint64_t hash{0};
+            std::string bytes;
+        };
+        std::mutex _mutex;
+        std::vector<record> _records;
+
+        void store(std::size_t index, record);
+    };
+}
+
+#endif // __LEVEL_PACK_HPP__
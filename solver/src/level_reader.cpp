@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <cstdint>
+
+#include <boost/json/basic_parser_impl.hpp>
+
+#include "level_reader.hpp"
+
+namespace chilly
+{
+    namespace
+    {
+        /// The SAX handler: follows the nesting of the level file and
+        /// keeps the fields of the level object at hand.
+        class level_handler
+        {
+        public:
+            static constexpr std::size_t max_object_size = std::size_t(-1);
+            static constexpr std::size_t max_array_size = std::size_t(-1);
+            static constexpr std::size_t max_key_size = std::size_t(-1);
+            static constexpr std::size_t max_string_size = std::size_t(-1);
+
+            explicit level_handler(std::function<bool(std::size_t, level_grid const &)> const &visit)
+                : _visit(visit)
+            {
+            }
+
+            /// true once `visit` asked to stop or the file turned out not
+            /// to be a level file
+            bool stopped() const
+            {
+                return _stopped;
+            }
+            std::string const &problem() const
+            {
+                return _problem;
+            }
+            /// false if the document is no list at all
+            bool saw_list() const
+            {
+                return _saw_list;
+            }
+
+            bool on_document_begin(boost::json::error_code &)
+            {
+                return true;
+            }
+            bool on_document_end(boost::json::error_code &)
+            {
+                return true;
+            }
+
+            bool on_array_begin(boost::json::error_code &)
+            {
+                if (_depth == 0)
+                {
+                    _saw_list = true;
+                }
+                else if (_depth == LevelDepth && _field == field::data)
+                {
+                    _in_rows = true;
+                }
+                ++_depth;
+                return true;
+            }
+            bool on_array_end(std::size_t, boost::json::error_code &)
+            {
+                --_depth;
+                _in_rows = false;
+                return true;
+            }
+
+            bool on_object_begin(boost::json::error_code &)
+            {
+                if (_depth == 0)
+                {
+                    stop("the file holds no list of levels");
+                }
+                else if (_depth == 1)
+                {
+                    _grid.name.clear();
+                    _grid.points = 0;
+                    _grid.thresholds.clear();
+                    _grid.width = 0;
+                    _grid.height = 0;
+                    _grid.tiles.clear();
+                    _grid.rectangular = true;
+                    _grid.row_ends.clear();
+                }
+                ++_depth;
+                return true;
+            }
+            bool on_object_end(std::size_t, boost::json::error_code &)
+            {
+                if (--_depth == 1 && !_stopped)
+                {
+                    finish_level();
+                }
+                _field = field::other;
+                return true;
+            }
+
+            bool on_key_part(boost::json::string_view s, std::size_t, boost::json::error_code &)
+            {
+                if (_depth == LevelDepth)
+                {
+                    _key.append(s.data(), s.size());
+                }
+                return true;
+            }
+            bool on_key(boost::json::string_view s, std::size_t, boost::json::error_code &)
+            {
+                if (_depth == LevelDepth)
+                {
+                    _key.append(s.data(), s.size());
+                    _field = _key == "data"         ? field::data
+                             : _key == "name"       ? field::name
+                             : _key == "basePoints" ? field::points
+                             : _key == "thresholds" ? field::thresholds
+                                                    : field::other;
+                    _key.clear();
+                }
+                return true;
+            }
+
+            bool on_string_part(boost::json::string_view s, std::size_t, boost::json::error_code &)
+            {
+                string_part(s);
+                return true;
+            }
+            bool on_string(boost::json::string_view s, std::size_t, boost::json::error_code &)
+            {
+                string_part(s);
+                if (_in_rows && _depth == LevelDepth + 1)
+                {
+                    _decoder.finish(_grid.tiles);
+                    std::vector<std::size_t> &row_ends = _grid.row_ends;
+                    std::size_t const begin = row_ends.empty() ? 0 : row_ends.back();
+                    int const width = static_cast<int>(_grid.tiles.size() - begin);
+                    if (row_ends.empty())
+                    {
+                        _grid.width = width;
+                    }
+                    else if (width != _grid.width)
+                    {
+                        _grid.rectangular = false;
+                    }
+                    row_ends.push_back(_grid.tiles.size());
+                    ++_grid.height;
+                }
+                return true;
+            }
+
+            bool on_number_part(boost::json::string_view, boost::json::error_code &)
+            {
+                return true;
+            }
+            bool on_int64(std::int64_t i, boost::json::string_view, boost::json::error_code &)
+            {
+                number(static_cast<int>(i));
+                return true;
+            }
+            bool on_uint64(std::uint64_t u, boost::json::string_view, boost::json::error_code &)
+            {
+                number(static_cast<int>(u));
+                return true;
+            }
+            bool on_double(double d, boost::json::string_view, boost::json::error_code &)
+            {
+                number(static_cast<int>(d));
+                return true;
+            }
+            bool on_bool(bool, boost::json::error_code &)
+            {
+                return true;
+            }
+            bool on_null(boost::json::error_code &)
+            {
+                return true;
+            }
+            bool on_comment_part(boost::json::string_view, boost::json::error_code &)
+            {
+                return true;
+            }
+            bool on_comment(boost::json::string_view, boost::json::error_code &)
+            {
+                return true;
+            }
+
+        private:
+            /// depth of the fields of a level object
+            static constexpr int LevelDepth = 2;
+
+            enum class field
+            {
+                other,
+                name,
+                points,
+                thresholds,
+                data,
+            };
+
+            std::function<bool(std::size_t, level_grid const &)> const &_visit;
+            level_grid _grid;
+            tile_decoder _decoder;
+            std::string _key;
+            field _field{field::other};
+            int _depth{0};
+            bool _saw_list{false};
+            bool _in_rows{false};
+            std::size_t _index{0};
+            bool _stopped{false};
+            std::string _problem;
+
+            void stop(std::string problem)
+            {
+                _stopped = true;
+                _problem = std::move(problem);
+            }
+
+            void string_part(boost::json::string_view s)
+            {
+                if (_in_rows && _depth == LevelDepth + 1)
+                {
+                    _decoder.feed(std::string_view(s.data(), s.size()), _grid.tiles);
+                }
+                else if (_depth == LevelDepth && _field == field::name)
+                {
+                    _grid.name.append(s.data(), s.size());
+                }
+            }
+
+            void number(int n)
+            {
+                if (_depth == LevelDepth && _field == field::points)
+                {
+                    _grid.points = n;
+                }
+                else if (_depth == LevelDepth + 1 && _field == field::thresholds)
+                {
+                    _grid.thresholds.push_back(n);
+                }
+            }
+
+            void finish_level()
+            {
+                if (_grid.name.empty())
+                {
+                    _grid.name = "<no name>";
+                }
+                if (!_visit(_index++, _grid))
+                {
+                    _stopped = true;
+                }
+            }
+        };
+
+        /// bytes handed to the parser at a time, and so how far it reads
+        /// past a level that stopped the search
+        constexpr std::size_t ChunkSize = std::size_t{1} << 16;
+    }
+
+    level level_grid::to_level() const
+    {
+        level lvl{name, points, {}, thresholds};
+        lvl.data.reserve(row_ends.size());
+        std::size_t begin = 0;
+        for (std::size_t end : row_ends)
+        {
+            lvl.data.emplace_back(std::begin(tiles) + static_cast<std::ptrdiff_t>(begin), std::begin(tiles) + static_cast<std::ptrdiff_t>(end));
+            begin = end;
+        }
+        return lvl;
+    }
+
+    level_reader::level_reader(std::string const &path)
+        : _file(path)
+    {
+    }
+
+    bool level_reader::for_each(std::function<bool(std::size_t, level_grid const &)> const &visit)
+    {
+        _error.clear();
+        if (!_file.is_open())
+        {
+            _error = "cannot read the file";
+            return false;
+        }
+        boost::json::basic_parser<level_handler> parser(boost::json::parse_options{}, visit);
+        std::string_view const text = _file.view();
+        for (std::size_t offset = 0; offset < text.size(); offset += ChunkSize)
+        {
+            std::size_t const n = std::min(ChunkSize, text.size() - offset);
+            boost::json::error_code ec;
+            parser.write_some(offset + n < text.size(), text.data() + offset, n, ec);
+            if (ec)
+            {
+                _error = ec.message();
+                return false;
+            }
+            if (parser.handler().stopped())
+                break;
+        }
+        if (!parser.handler().problem().empty())
+        {
+            _error = parser.handler().problem();
+            return false;
+        }
+        if (!parser.handler().saw_list())
+        {
+            _error = "the file holds no list of levels";
+            return false;
+        }
+        return true;
+    }
+
+    std::optional<level_grid> level_reader::find(std::size_t index)
+    {
+        std::optional<level_grid> found;
+        for_each([&found, index](std::size_t i, level_grid const &grid)
+                 {
+                     if (i != index)
+                         return true;
+                     found = grid;
+                     return false; });
+        return found;
+    }
+
+    std::optional<level_grid> level_reader::find(std::string_view name)
+    {
+        std::optional<level_grid> found;
+        for_each([&found, name](std::size_t, level_grid const &grid)
+                 {
+                     if (grid.name != name)
+                         return true;
+                     found = grid;
+                     return false; });
+        return found;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef __LEVEL_READER_HPP__
+#define __LEVEL_READER_HPP__
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chilly.hpp"
+#include "mapped_file.hpp"
+
+namespace chilly
+{
+    /// A level as the level reader hands it out: the board as row-major
+    /// tiles in one buffer instead of a vector per row.
+    struct level_grid
+    {
+        std::string name;
+        int points{0};
+        std::vector<int> thresholds;
+        int width{0};
+        int height{0};
+        std::vector<tile_t> tiles;
+        /// where every row ends in `tiles`
+        std::vector<std::size_t> row_ends;
+        /// false if the rows differ in width; `width` is the first row's
+        bool rectangular{true};
+
+        /// the board as `solver` takes it
+        level to_level() const;
+    };
+
+    /// Reads levels from a level file without building its JSON document.
+    ///
+    /// The file is mapped into memory and fed to a SAX parser, which hands
+    /// the name, points, thresholds and rows of one level object after the
+    /// other to a handler. Rows go straight into the single tile buffer of
+    /// the level at hand, which the next level reuses, and anything else
+    /// in a level object is skipped. Selecting one level stops reading the
+    /// file soon after it is complete.
+    class level_reader
+    {
+    public:
+        explicit level_reader(std::string const &path);
+
+        bool is_open() const
+        {
+            return _file.is_open();
+        }
+        /// what went wrong if a search below failed to read the file
+        std::string const &error() const
+        {
+            return _error;
+        }
+
+        /// Hand every level to `visit` in file order, with its index, until
+        /// `visit` returns false. The grid is only valid during the call.
+        /// Returns false if the file is not a complete level file.
+        bool for_each(std::function<bool(std::size_t, level_grid const &)> const &visit);
+        /// the level at 0-based `index`
+        std::optional<level_grid> find(std::size_t index);
+        /// the first level called `name`
+        std::optional<level_grid> find(std::string_view name);
+
+    private:
+        mapped_file _file;
+        std::string _error;
+    };
+}
+
+#endif // __LEVEL_READER_HPP__
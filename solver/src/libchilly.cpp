@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "chilly.hpp"
+#include "libchilly.h"
+#include "routes.hpp"
+#include "tour.hpp"
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    bool is_board(unsigned char const *tiles, int width, int height)
+    {
+        return tiles != nullptr && width > 0 && height > 0;
+    }
+
+    std::vector<std::vector<chilly::tile_t>> board_of(unsigned char const *tiles, int width, int height)
+    {
+        std::vector<std::vector<chilly::tile_t>> data(static_cast<std::size_t>(height));
+        for (std::size_t y = 0; y < data.size(); ++y)
+        {
+            unsigned char const *row = tiles + y * static_cast<std::size_t>(width);
+            data[y].reserve(static_cast<std::size_t>(width));
+            for (int x = 0; x < width; ++x)
+            {
+                data[y].push_back(static_cast<chilly::tile_t>(row[x]));
+            }
+        }
+        return data;
+    }
+
+    /// Write `moves` with a NUL to `buffer` if both fit, and their length
+    /// to `length` anyway.
+    int put_moves(std::string const &moves, char *buffer, std::size_t capacity, std::size_t *length)
+    {
+        if (length != nullptr)
+        {
+            *length = moves.size();
+        }
+        if (buffer == nullptr || capacity <= moves.size())
+            return CHILLY_BUFFER_TOO_SMALL;
+        std::memcpy(buffer, moves.data(), moves.size());
+        buffer[moves.size()] = '\0';
+        return CHILLY_OK;
+    }
+
+    void put_stats(chilly_stats *stats, chilly::solve_stats const &s, std::size_t iterations)
+    {
+        if (stats == nullptr)
+            return;
+        chilly_stats all{};
+        all.size = stats->size;
+        all.nodes = s.nodes;
+        all.edges = s.edges;
+        all.iterations = iterations;
+        all.states_expanded = s.states_expanded;
+        all.states_pruned = s.states_pruned;
+        all.peak_frontier = s.peak_frontier;
+        all.peak_bytes = s.peak_bytes;
+        all.graph_ms = s.graph_ms;
+        all.search_ms = s.search_ms;
+        std::memcpy(stats, &all, std::min<std::size_t>(stats->size, sizeof all));
+    }
+
+    /// Run `body`, turning exceptions into a status, as none may cross the
+    /// C interface.
+    template <class F>
+    int guarded(F &&body)
+    {
+        try
+        {
+            return body();
+        }
+        catch (std::bad_alloc const &)
+        {
+            return CHILLY_TOO_LARGE;
+        }
+        catch (...)
+        {
+            return CHILLY_INTERNAL_ERROR;
+        }
+    }
+}
+
+extern "C"
+{
+    int chilly_abi_version(void)
+    {
+        return CHILLY_ABI_VERSION;
+    }
+
+    const char *chilly_status_message(int status)
+    {
+        switch (status)
+        {
+        case CHILLY_OK:
+            return "ok";
+        case CHILLY_NO_ROUTE:
+            return "no route";
+        case CHILLY_INVALID_ARGUMENT:
+            return "invalid argument";
+        case CHILLY_BUFFER_TOO_SMALL:
+            return "buffer too small";
+        case CHILLY_TOO_LARGE:
+            return "level too large";
+        case CHILLY_INTERNAL_ERROR:
+            return "internal error";
+        default:
+            return "unknown status";
+        }
+    }
+
+    int chilly_shortest_path(const unsigned char *tiles, int width, int height, int search,
+                             char *moves, size_t moves_capacity, size_t *moves_length,
+                             struct chilly_stats *stats)
+    {
+        if (!is_board(tiles, width, height) || search < CHILLY_SEARCH_BFS || search > CHILLY_SEARCH_PARALLEL)
+            return CHILLY_INVALID_ARGUMENT;
+        return guarded([&]()
+                       {
+                           chilly::path_search const modes[] = {chilly::path_search::breadth_first, chilly::path_search::a_star,
+                                                                chilly::path_search::bidirectional, chilly::path_search::parallel};
+                           chilly::solver solver(board_of(tiles, width, height));
+                           chilly::solver::result const result = solver.shortest_path(modes[search]);
+                           put_stats(stats, solver.stats(), result.iterations);
+                           int const status = put_moves(chilly::moves_of(result.route), moves, moves_capacity, moves_length);
+                           return result.route.empty() && status == CHILLY_OK ? CHILLY_NO_ROUTE : status; });
+    }
+
+    int chilly_coin_route(const unsigned char *tiles, int width, int height, double timeout_seconds,
+                          char *moves, size_t moves_capacity, size_t *moves_length, int *optimal,
+                          struct chilly_stats *stats)
+    {
+        if (!is_board(tiles, width, height))
+            return CHILLY_INVALID_ARGUMENT;
+        return guarded([&]()
+                       {
+                           auto const deadline = timeout_seconds > 0 ? clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(timeout_seconds))
+                                                                     : clock::time_point::max();
+                           chilly::solver solver(board_of(tiles, width, height));
+                           chilly::move_graph const &graph = solver.graph();
+                           chilly::distance_matrix const distances(graph);
+                           chilly::tour_solver::result const result = chilly::tour_solver(graph, distances).solve(1, deadline);
+                           put_stats(stats, solver.stats(), result.iterations);
+                           if (optimal != nullptr)
+                           {
+                               *optimal = result.optimal ? 1 : 0;
+                           }
+                           int const status = put_moves(chilly::moves_of(result.route), moves, moves_capacity, moves_length);
+                           return result.route.empty() && status == CHILLY_OK ? CHILLY_NO_ROUTE : status; });
+    }
+
+    int chilly_k_shortest_routes(const unsigned char *tiles, int width, int height, int collect_all, size_t k,
+                                 char *moves, size_t moves_capacity, size_t *lengths, size_t *count,
+                                 struct chilly_stats *stats)
+    {
+        if (!is_board(tiles, width, height) || (k > 0 && lengths == nullptr))
+            return CHILLY_INVALID_ARGUMENT;
+        return guarded([&]()
+                       {
+                           chilly::solver solver(board_of(tiles, width, height));
+                           chilly::route_space const routes(solver.graph(), collect_all != 0);
+                           put_stats(stats, solver.stats(), routes.size());
+                           if (!routes.complete())
+                               return CHILLY_TOO_LARGE;
+                           std::vector<chilly::path> const found = routes.k_shortest(k);
+                           if (count != nullptr)
+                           {
+                               *count = found.size();
+                           }
+                           std::size_t needed = 0;
+                           for (std::size_t i = 0; i < found.size(); ++i)
+                           {
+                               lengths[i] = found[i].size() - 1;
+                               needed += found[i].size();
+                           }
+                           if (found.empty())
+                               return CHILLY_NO_ROUTE;
+                           if (moves == nullptr || moves_capacity < needed)
+                               return CHILLY_BUFFER_TOO_SMALL;
+                           for (auto const &route : found)
+                           {
+                               std::string const m = chilly::moves_of(route);
+                               std::memcpy(moves, m.c_str(), m.size() + 1);
+                               moves += m.size() + 1;
+                           }
+                           return CHILLY_OK; });
+    }
+
+    int chilly_walk_counts(const unsigned char *tiles, int width, int height, int collect_all,
+                           size_t max_length, uint64_t *counts, struct chilly_stats *stats)
+    {
+        if (!is_board(tiles, width, height) || counts == nullptr || max_length > CHILLY_MAX_WALK_LENGTH)
+            return CHILLY_INVALID_ARGUMENT;
+        return guarded([&]()
+                       {
+                           chilly::solver solver(board_of(tiles, width, height));
+                           chilly::route_space const routes(solver.graph(), collect_all != 0);
+                           put_stats(stats, solver.stats(), routes.size());
+                           if (!routes.complete())
+                               return CHILLY_TOO_LARGE;
+                           std::vector<std::uint64_t> const found = routes.count_walks_by_length(max_length);
+                           std::copy(std::begin(found), std::end(found), counts);
+                           return routes.shortest_length().has_value() ? CHILLY_OK : CHILLY_NO_ROUTE; });
+    }
+
+    int chilly_thresholds(const unsigned char *tiles, int width, int height, size_t thresholds[3])
+    {
+        if (!is_board(tiles, width, height) || thresholds == nullptr)
+            return CHILLY_INVALID_ARGUMENT;
+        return guarded([&]()
+                       {
+                           chilly::solver solver(board_of(tiles, width, height));
+                           chilly::route_space const routes(solver.graph(), false);
+                           if (!routes.complete())
+                               return CHILLY_TOO_LARGE;
+                           std::vector<std::size_t> const found = routes.thresholds();
+                           if (found.empty())
+                               return CHILLY_NO_ROUTE;
+                           std::copy(std::begin(found), std::end(found), thresholds);
+                           return CHILLY_OK; });
+    }
+}
@@ -0,0 +1,145 @@
+#ifndef __LIBCHILLY_H__
+#define __LIBCHILLY_H__
+
+/*
+ * C interface of the chilly solver, for loading it into other languages'
+ * processes (ctypes, FFI) as the shared library libchilly.
+ *
+ * A level is passed as its tiles, row after row, one byte per tile with
+ * the characters of the level file (' ' ice, '#' rock, 'P' player,
+ * 'X' exit, '$' coin, 'O' hole and so on). Results go to buffers the
+ * caller provides. Moves are written as the letters L, R, U and D with a
+ * terminating NUL; if the buffer is too small, nothing but the length
+ * needed is written and CHILLY_BUFFER_TOO_SMALL is returned. Every call
+ * works on its own solver, so calls may come from any number of threads.
+ *
+ * Structs only ever grow at the end: the caller sets `size` to the size
+ * of the struct it was compiled against, and the library fills in no
+ * more than that.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(CHILLY_BUILDING_LIBRARY)
+#define CHILLY_API __declspec(dllexport)
+#else
+#define CHILLY_API __declspec(dllimport)
+#endif
+#else
+#define CHILLY_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* bumped whenever a function or struct changes incompatibly */
+#define CHILLY_ABI_VERSION 1
+
+/* the longest walks chilly_walk_counts counts */
+#define CHILLY_MAX_WALK_LENGTH 65536
+
+    enum chilly_status
+    {
+        CHILLY_OK = 0,
+        /* the level has no route of the kind asked for */
+        CHILLY_NO_ROUTE = 1,
+        CHILLY_INVALID_ARGUMENT = -1,
+        CHILLY_BUFFER_TOO_SMALL = -2,
+        /* too many states to search, or out of memory */
+        CHILLY_TOO_LARGE = -3,
+        CHILLY_INTERNAL_ERROR = -4,
+    };
+
+    enum chilly_search
+    {
+        CHILLY_SEARCH_BFS = 0,
+        CHILLY_SEARCH_ASTAR = 1,
+        CHILLY_SEARCH_BIDIRECTIONAL = 2,
+        /* over the cells of the board on all hardware threads */
+        CHILLY_SEARCH_PARALLEL = 3,
+    };
+
+    /* Counters of one call; times in milliseconds. */
+    struct chilly_stats
+    {
+        uint32_t size;
+        uint32_t reserved;
+        uint64_t nodes;
+        uint64_t edges;
+        /* moves looked at, or the number of (stop, coins collected)
+           states for the functions that count and list routes */
+        uint64_t iterations;
+        uint64_t states_expanded;
+        uint64_t states_pruned;
+        uint64_t peak_frontier;
+        uint64_t peak_bytes;
+        double graph_ms;
+        double search_ms;
+    };
+
+    /* CHILLY_ABI_VERSION of the library actually loaded */
+    CHILLY_API int chilly_abi_version(void);
+
+    /* A short English description of a status. */
+    CHILLY_API const char *chilly_status_message(int status);
+
+    /*
+     * A route with the least number of moves from the player to an exit,
+     * ignoring coins. `moves_length`, if not NULL, receives the number of
+     * moves; `stats`, if not NULL, the counters of the search.
+     */
+    CHILLY_API int chilly_shortest_path(const unsigned char *tiles, int width, int height, int search,
+                                        char *moves, size_t moves_capacity, size_t *moves_length,
+                                        struct chilly_stats *stats);
+
+    /*
+     * A short route that collects every coin before it leaves through an
+     * exit. The search gives up improving on its route after
+     * `timeout_seconds` (0 or less for no limit); `optimal`, if not NULL,
+     * is set to 1 if the route is provably minimal, else to 0.
+     */
+    CHILLY_API int chilly_coin_route(const unsigned char *tiles, int width, int height, double timeout_seconds,
+                                     char *moves, size_t moves_capacity, size_t *moves_length, int *optimal,
+                                     struct chilly_stats *stats);
+
+    /*
+     * Up to `k` shortest routes, shortest first, that never pass the same
+     * stop with the same coins twice; with `collect_all` only those that
+     * collect every coin. The moves of the routes are written one after
+     * the other, each with its NUL, and their number of moves to
+     * `lengths`, which holds `k` entries. `count` receives the number of
+     * routes found. If `moves` is too small, only `lengths` and `count`
+     * are written; the routes need the sum of their lengths plus one byte
+     * per route.
+     */
+    CHILLY_API int chilly_k_shortest_routes(const unsigned char *tiles, int width, int height, int collect_all, size_t k,
+                                            char *moves, size_t moves_capacity, size_t *lengths, size_t *count,
+                                            struct chilly_stats *stats);
+
+    /*
+     * The number of walks to an exit of every length from 0 to
+     * `max_length` moves, written to `counts`, which holds
+     * `max_length + 1` entries. Unlike the routes above, a walk may pass
+     * the same stop with the same coins more than once, so beyond the
+     * shortest length there are more walks than routes. Counts saturate
+     * at UINT64_MAX. A `max_length` above CHILLY_MAX_WALK_LENGTH is an
+     * invalid argument.
+     */
+    CHILLY_API int chilly_walk_counts(const unsigned char *tiles, int width, int height, int collect_all,
+                                      size_t max_length, uint64_t *counts, struct chilly_stats *stats);
+
+    /*
+     * The three star thresholds chilly_solver --all suggests, taken from
+     * the lengths of the walks to an exit.
+     */
+    CHILLY_API int chilly_thresholds(const unsigned char *tiles, int width, int height, size_t thresholds[3]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LIBCHILLY_H__ */
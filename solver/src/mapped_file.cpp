@@ -0,0 +1,53 @@
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.hpp"
+
+namespace chilly
+{
+    mapped_file::mapped_file(std::string const &path)
+    {
+#ifndef _WIN32
+        int const fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                _data = static_cast<char const *>(p);
+                _size = static_cast<std::size_t>(st.st_size);
+                _mapped = true;
+            }
+        }
+        ::close(fd);
+#else
+        std::ifstream ifs(path, std::ios::binary);
+        _buffer.assign(std::istreambuf_iterator<char>(ifs), {});
+        if (!_buffer.empty())
+        {
+            _data = _buffer.data();
+            _size = _buffer.size();
+        }
+#endif
+    }
+
+    mapped_file::~mapped_file()
+    {
+#ifndef _WIN32
+        if (_mapped)
+        {
+            ::munmap(const_cast<char *>(_data), _size);
+        }
+#endif
+    }
+}
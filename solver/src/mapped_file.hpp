@@ -0,0 +1,46 @@
+#ifndef __MAPPED_FILE_HPP__
+#define __MAPPED_FILE_HPP__
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace chilly
+{
+    /// A whole file mapped read-only into memory, or read into a buffer
+    /// where mapping is not available. A file that cannot be opened, or is
+    /// empty, leaves no data.
+    class mapped_file
+    {
+    public:
+        explicit mapped_file(std::string const &path);
+        ~mapped_file();
+        mapped_file(mapped_file const &) = delete;
+        mapped_file &operator=(mapped_file const &) = delete;
+
+        bool is_open() const
+        {
+            return _data != nullptr;
+        }
+        char const *data() const
+        {
+            return _data;
+        }
+        std::size_t size() const
+        {
+            return _size;
+        }
+        std::string_view view() const
+        {
+            return std::string_view(_data == nullptr ? "" : _data, _size);
+        }
+
+    private:
+        char const *_data{nullptr};
+        std::size_t _size{0};
+        bool _mapped{false};
+        std::string _buffer;
+    };
+}
+
+#endif // __MAPPED_FILE_HPP__
@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <functional>
+#include <queue>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include "routes.hpp"
+
+namespace chilly
+{
+    namespace
+    {
+        std::uint64_t saturating_add(std::uint64_t a, std::uint64_t b)
+        {
+            return a > UINT64_MAX - b ? UINT64_MAX : a + b;
+        }
+    }
+
+    route_space::route_space(move_graph const &g, bool collect_all)
+        : _graph(g)
+    {
+        if (g.size() == 0 || (collect_all && g.collectible_count() > solver::MaxCollectibles))
+        {
+            _complete = false;
+            return;
+        }
+
+        // number the states breadth first; exits end a route, so they have
+        // no successors
+        std::unordered_map<coin_state, std::int32_t, coin_state> index;
+        std::vector<std::uint64_t> collected;
+        auto state_of = [this, &index, &collected](move_graph::node_id n, std::uint64_t coins)
+        {
+            auto const [it, added] = index.try_emplace(coin_state{n, coins}, static_cast<std::int32_t>(_nodes.size()));
+            if (added)
+            {
+                _nodes.push_back(n);
+                collected.push_back(coins);
+            }
+            return it->second;
+        };
+        state_of(move_graph::root(), 0);
+        for (std::size_t s = 0; s < _nodes.size(); ++s)
+        {
+            if (_nodes.size() > MaxStates)
+            {
+                _complete = false;
+                _nodes.clear();
+                _successors.clear();
+                return;
+            }
+            _successors.insert(std::end(_successors), move_graph::Slots, NoState);
+            move_graph::node_id const n = _nodes[s];
+            if (g.is_exit(n))
+                continue;
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                move_graph::node_id const next = g.successor(n, slot);
+                if (next == move_graph::NoNode)
+                    continue;
+                std::uint64_t const coins = collect_all ? collected[s] | g.coins(n, slot) : 0;
+                _successors[s * move_graph::Slots + static_cast<std::size_t>(slot)] = state_of(next, coins);
+            }
+        }
+
+        // label the states with their distance to the nearest goal,
+        // searching backwards along predecessors kept as compressed rows
+        std::size_t const count = _nodes.size();
+        std::vector<std::uint32_t> first(count + 1, 0);
+        for (std::int32_t t : _successors)
+        {
+            if (t != NoState)
+            {
+                ++first[static_cast<std::size_t>(t) + 1];
+            }
+        }
+        for (std::size_t s = 0; s < count; ++s)
+        {
+            first[s + 1] += first[s];
+        }
+        std::vector<std::int32_t> predecessors(first.back());
+        std::vector<std::uint32_t> fill(std::begin(first), std::end(first) - 1);
+        for (std::size_t i = 0; i < _successors.size(); ++i)
+        {
+            if (std::int32_t const t = _successors[i]; t != NoState)
+            {
+                predecessors[fill[static_cast<std::size_t>(t)]++] = static_cast<std::int32_t>(i / move_graph::Slots);
+            }
+        }
+        _to_goal.assign(count, Unreachable);
+        std::vector<std::int32_t> queue;
+        for (std::size_t s = 0; s < count; ++s)
+        {
+            if (g.is_exit(_nodes[s]) && (!collect_all || collected[s] == g.all_collected()))
+            {
+                _to_goal[s] = 0;
+                queue.push_back(static_cast<std::int32_t>(s));
+            }
+        }
+        for (std::size_t i = 0; i < queue.size(); ++i)
+        {
+            std::size_t const t = static_cast<std::size_t>(queue[i]);
+            for (std::uint32_t j = first[t]; j < first[t + 1]; ++j)
+            {
+                std::size_t const s = static_cast<std::size_t>(predecessors[j]);
+                if (_to_goal[s] == Unreachable)
+                {
+                    _to_goal[s] = _to_goal[t] + 1;
+                    queue.push_back(predecessors[j]);
+                }
+            }
+        }
+    }
+
+    std::optional<std::size_t> route_space::shortest_length() const
+    {
+        if (_to_goal.empty() || _to_goal.front() == Unreachable)
+            return std::nullopt;
+        return _to_goal.front();
+    }
+
+    std::vector<std::uint8_t> route_space::downhill(std::int32_t state) const
+    {
+        assert(_to_goal[static_cast<std::size_t>(state)] != Unreachable);
+        std::vector<std::uint8_t> slots;
+        while (!is_goal(state))
+        {
+            std::uint32_t const distance = _to_goal[static_cast<std::size_t>(state)];
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                std::int32_t const next = successor(state, slot);
+                if (next != NoState && _to_goal[static_cast<std::size_t>(next)] + 1 == distance)
+                {
+                    slots.push_back(static_cast<std::uint8_t>(slot));
+                    state = next;
+                    break;
+                }
+            }
+        }
+        return slots;
+    }
+
+    path route_space::to_path(std::vector<std::uint8_t> const &slots) const
+    {
+        std::vector<move_graph::node_id> ids{_nodes.front()};
+        std::vector<direction_t> moves{NoDirection};
+        std::int32_t state = 0;
+        for (std::uint8_t slot : slots)
+        {
+            state = successor(state, slot);
+            ids.push_back(_nodes[static_cast<std::size_t>(state)]);
+            moves.push_back(move_graph::direction_of(slot));
+        }
+        return _graph.route(ids, moves);
+    }
+
+    std::vector<path> route_space::k_shortest(std::size_t k) const
+    {
+        if (k == 0 || !shortest_length().has_value())
+            return {};
+
+        // Yen's algorithm: every route found so far is branched off at each
+        // of its states in turn. The branch keeps the route's moves up to
+        // there, then takes the shortest way to a goal that neither returns
+        // to a state of the kept part nor leaves the branching state the way
+        // any route found with the same beginning does. The shortest of all
+        // branches not taken yet is the next route.
+        auto shorter = [](std::vector<std::uint8_t> const &a, std::vector<std::uint8_t> const &b)
+        {
+            return a.size() != b.size() ? a.size() < b.size() : a < b;
+        };
+        std::vector<std::vector<std::uint8_t>> routes{downhill(0)};
+        std::set<std::vector<std::uint8_t>, decltype(shorter)> candidates(shorter);
+
+        // scratch of the branch searches, told apart by a stamp per search
+        std::size_t const count = size();
+        std::vector<std::uint32_t> stamp(count, 0);
+        std::vector<std::uint32_t> blocked(count, 0);
+        std::vector<std::uint32_t> cost(count);
+        std::vector<std::int32_t> parent(count);
+        std::vector<std::uint8_t> parent_slot(count);
+        std::uint32_t search = 0;
+        using open_state = std::pair<std::uint32_t, std::int32_t>;
+        std::priority_queue<open_state, std::vector<open_state>, std::greater<open_state>> open;
+
+        // A* from `from` to the nearest goal; the distances to goal were
+        // taken without blocked states or removed moves, so they never
+        // overestimate
+        auto branch = [&](std::int32_t from, std::array<bool, move_graph::Slots> const &removed) -> std::optional<std::vector<std::uint8_t>>
+        {
+            open = {};
+            stamp[static_cast<std::size_t>(from)] = search;
+            cost[static_cast<std::size_t>(from)] = 0;
+            open.emplace(_to_goal[static_cast<std::size_t>(from)], from);
+            while (!open.empty())
+            {
+                auto const [f, s] = open.top();
+                open.pop();
+                std::size_t const current = static_cast<std::size_t>(s);
+                if (f != cost[current] + _to_goal[current])
+                    continue;
+                if (is_goal(s))
+                {
+                    std::vector<std::uint8_t> slots;
+                    for (std::int32_t t = s; t != from; t = parent[static_cast<std::size_t>(t)])
+                    {
+                        slots.push_back(parent_slot[static_cast<std::size_t>(t)]);
+                    }
+                    std::reverse(std::begin(slots), std::end(slots));
+                    return slots;
+                }
+                for (int slot = 0; slot < move_graph::Slots; ++slot)
+                {
+                    if (s == from && removed[static_cast<std::size_t>(slot)])
+                        continue;
+                    std::int32_t const t = successor(s, slot);
+                    if (t == NoState)
+                        continue;
+                    std::size_t const next = static_cast<std::size_t>(t);
+                    if (blocked[next] == search || _to_goal[next] == Unreachable ||
+                        (stamp[next] == search && cost[next] <= cost[current] + 1))
+                        continue;
+                    stamp[next] = search;
+                    cost[next] = cost[current] + 1;
+                    parent[next] = s;
+                    parent_slot[next] = static_cast<std::uint8_t>(slot);
+                    open.emplace(cost[next] + _to_goal[next], t);
+                }
+            }
+            return std::nullopt;
+        };
+
+        while (routes.size() < k)
+        {
+            std::vector<std::uint8_t> const last = routes.back();
+            std::vector<std::int32_t> states{0};
+            for (std::uint8_t slot : last)
+            {
+                states.push_back(successor(states.back(), slot));
+            }
+            for (std::size_t i = 0; i < last.size(); ++i)
+            {
+                ++search;
+                for (std::size_t j = 0; j < i; ++j)
+                {
+                    blocked[static_cast<std::size_t>(states[j])] = search;
+                }
+                std::array<bool, move_graph::Slots> removed{};
+                for (auto const &route : routes)
+                {
+                    if (route.size() > i && std::equal(std::begin(last), std::begin(last) + static_cast<std::ptrdiff_t>(i), std::begin(route)))
+                    {
+                        removed[route[i]] = true;
+                    }
+                }
+                if (auto const rest = branch(states[i], removed))
+                {
+                    std::vector<std::uint8_t> candidate(std::begin(last), std::begin(last) + static_cast<std::ptrdiff_t>(i));
+                    candidate.insert(std::end(candidate), std::begin(*rest), std::end(*rest));
+                    candidates.insert(std::move(candidate));
+                }
+            }
+            if (candidates.empty())
+                break;
+            routes.push_back(std::move(candidates.extract(std::begin(candidates)).value()));
+        }
+
+        std::vector<path> paths;
+        paths.reserve(routes.size());
+        for (auto const &route : routes)
+        {
+            paths.push_back(to_path(route));
+        }
+        return paths;
+    }
+
+    std::vector<std::uint64_t> route_space::count_walks_by_length(std::size_t max_length) const
+    {
+        std::vector<std::uint64_t> counts(max_length + 1, 0);
+        if (!shortest_length().has_value())
+            return counts;
+        if (is_goal(0))
+        {
+            counts[0] = 1;
+            return counts;
+        }
+
+        // walks of the current length per state they end in; only those
+        // that can still reach a goal within `max_length` are carried on
+        std::size_t const count = size();
+        std::vector<std::uint64_t> walks(count, 0);
+        std::vector<std::uint64_t> longer(count, 0);
+        walks[0] = 1;
+        for (std::size_t length = 1; length <= max_length; ++length)
+        {
+            std::fill(std::begin(longer), std::end(longer), 0);
+            bool any = false;
+            for (std::size_t s = 0; s < count; ++s)
+            {
+                if (walks[s] == 0)
+                    continue;
+                for (int slot = 0; slot < move_graph::Slots; ++slot)
+                {
+                    std::int32_t const t = successor(static_cast<std::int32_t>(s), slot);
+                    if (t == NoState)
+                        continue;
+                    std::size_t const next = static_cast<std::size_t>(t);
+                    if (_to_goal[next] == Unreachable || length + _to_goal[next] > max_length)
+                        continue;
+                    if (_to_goal[next] == 0)
+                    {
+                        counts[length] = saturating_add(counts[length], walks[s]);
+                    }
+                    else
+                    {
+                        longer[next] = saturating_add(longer[next], walks[s]);
+                        any = true;
+                    }
+                }
+            }
+            if (!any)
+                break;
+            walks.swap(longer);
+        }
+        return counts;
+    }
+
+    std::vector<std::size_t> route_space::thresholds() const
+    {
+        std::optional<std::size_t> const shortest = shortest_length();
+        if (!shortest.has_value())
+            return {};
+        std::size_t const n = *shortest;
+        // walks more than twice as long as the shortest earn no star
+        std::vector<std::uint64_t> const counts = count_walks_by_length(2 * n);
+        std::size_t two_stars = n + 1;
+        for (std::size_t length = n + 1; length < counts.size(); ++length)
+        {
+            if (counts[length] != 0)
+            {
+                two_stars = length;
+                break;
+            }
+        }
+        std::size_t one_star = two_stars;
+        std::uint64_t walks = 0;
+        for (std::size_t length = n; length < counts.size(); ++length)
+        {
+            if (counts[length] == 0)
+                continue;
+            one_star = std::max(two_stars, length);
+            walks = saturating_add(walks, counts[length]);
+            if (walks >= OneStarWalks)
+                break;
+        }
+        return {n, two_stars, one_star};
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef __ROUTES_HPP__
+#define __ROUTES_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "chilly.hpp"
+
+namespace chilly
+{
+    /// The ways a player can take through a level, as walks through the
+    /// states (stop, coins collected) reachable from the start. A walk ends
+    /// at the first exit it reaches; with `collect_all` it only counts if it
+    /// has collected every coin by then, otherwise coins are ignored and a
+    /// state is just a stop. A route is a walk that never passes the same
+    /// state twice.
+    ///
+    /// Walks of the shortest length are all routes, as one passing a state
+    /// twice could skip the loop in between. Longer walks may go round
+    /// loops, so beyond the shortest length there are more walks than
+    /// routes.
+    ///
+    /// The states are numbered once, breadth first, and labelled with their
+    /// distance to the nearest goal by a breadth-first search backwards.
+    /// That label makes the shortest route a matter of walking downhill, is
+    /// the exact heuristic for the A* searches of Yen's k shortest routes,
+    /// and tells the route counter which walks can still end in time.
+    class route_space
+    {
+    public:
+        static constexpr std::int32_t NoState = -1;
+        static constexpr std::uint32_t Unreachable = UINT32_MAX;
+        /// levels with more states are not explored
+        static constexpr std::size_t MaxStates = std::size_t{1} << 22;
+        /// walks up to the one-star threshold, see `thresholds()`
+        static constexpr std::uint64_t OneStarWalks = 1000;
+
+        route_space(move_graph const &, bool collect_all);
+
+        /// false if the level has too many states or coins to explore, in
+        /// which case there are no routes
+        bool complete() const
+        {
+            return _complete;
+        }
+        std::size_t size() const
+        {
+            return _nodes.size();
+        }
+
+        /// moves of the shortest route, if there is any
+        std::optional<std::size_t> shortest_length() const;
+        /// The `k` shortest routes, shortest first, none of which visits a
+        /// state twice. Routes of the same length come in the order of
+        /// their moves.
+        std::vector<path> k_shortest(std::size_t k) const;
+        /// How many walks there are of every length up to `max_length`
+        /// moves, indexed by length, loops included. Counting routes instead
+        /// would take a search of all of them; walks are counted per state
+        /// and length. Counts saturate at `UINT64_MAX`.
+        std::vector<std::uint64_t> count_walks_by_length(std::size_t max_length) const;
+        /// Star thresholds from the lengths of the walks there are: three
+        /// stars for a shortest one, two for the next length any walk has,
+        /// and one for every length up to that at which the walks counted
+        /// from the shortest length on reach `OneStarWalks`, though at most
+        /// twice the shortest length. Empty if there is no walk.
+        std::vector<std::size_t> thresholds() const;
+
+    private:
+        move_graph const &_graph;
+        bool _complete{true};
+        /// stop of every state
+        std::vector<move_graph::node_id> _nodes;
+        /// successor state of every state per move slot
+        std::vector<std::int32_t> _successors;
+        /// moves to the nearest goal per state
+        std::vector<std::uint32_t> _to_goal;
+
+        std::int32_t successor(std::int32_t state, int slot) const
+        {
+            return _successors[static_cast<std::size_t>(state) * move_graph::Slots + static_cast<std::size_t>(slot)];
+        }
+        bool is_goal(std::int32_t state) const
+        {
+            return _to_goal[static_cast<std::size_t>(state)] == 0;
+        }
+        /// a shortest route from `state` on, as move slots
+        std::vector<std::uint8_t> downhill(std::int32_t state) const;
+        path to_path(std::vector<std::uint8_t> const &slots) const;
+    };
+}
+
+#endif // __ROUTES_HPP__
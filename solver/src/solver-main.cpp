@@ -1,48 +1,814 @@
 #include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <csignal>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <functional>
-#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <span>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
 #include "chilly.hpp"
+#include "ida.hpp"
+#include "level_pack.hpp"
+#include "level_reader.hpp"
+#include "routes.hpp"
+#include "thread_pool.hpp"
+#include "tour.hpp"
 
 const std::size_t KEEP_N_BEST_ROUTES = 20;
+const double DEFAULT_TIMEOUT_SECONDS = 10;
+/// longer than anyone waits, and far from overflowing a clock duration
+const double MAX_TIMEOUT_SECONDS = 365.0 * 24 * 60 * 60;
+/// requests of one server client being solved or waiting for a worker;
+/// reading more of its requests waits until some have been answered
+const std::size_t MAX_REQUESTS_IN_FLIGHT = 16;
+/// clients served at a time; further ones wait to be accepted
+const std::size_t MAX_CONNECTIONS = 64;
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    /// `seconds` as a duration, clamped to [0, MAX_TIMEOUT_SECONDS]
+    clock::duration timeout_of(double seconds)
+    {
+        return std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(std::min(std::max(0.0, seconds), MAX_TIMEOUT_SECONDS)));
+    }
+
+    double milliseconds_since(clock::time_point t0)
+    {
+        return std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+    }
+
+    bool is_rectangular(std::vector<std::vector<chilly::tile_t>> const &data)
+    {
+        return !data.empty() && !data.front().empty() &&
+               std::all_of(std::begin(data), std::end(data), [&data](std::vector<chilly::tile_t> const &row)
+                           { return row.size() == data.front().size(); });
+    }
+
+    struct route_summary
+    {
+        bool found;
+        std::string moves;
+        std::uint64_t iterations;
+    };
+
+    /// The routes part of a batch report, the same whether the routes were
+    /// just found or come from a level pack.
+    void add_routes(boost::json::object &report, route_summary const &shortest, route_summary const &coins,
+                    bool coins_optimal, bool timed_out)
+    {
+        if (!shortest.found)
+        {
+            report["shortestRoute"] = nullptr;
+            report["thresholds"] = nullptr;
+        }
+        else
+        {
+            std::size_t const n = shortest.moves.size();
+            report["shortestRoute"] = boost::json::object{{"moves", shortest.moves},
+                                                          {"length", n},
+                                                          {"iterations", shortest.iterations}};
+            report["thresholds"] = boost::json::array{n, n + 1, static_cast<std::size_t>(std::lround(static_cast<double>(n) * 1.4))};
+        }
+        if (!coins.found)
+        {
+            report["coinRoute"] = nullptr;
+        }
+        else
+        {
+            report["coinRoute"] = boost::json::object{{"moves", coins.moves},
+                                                      {"length", coins.moves.size()},
+                                                      {"optimal", coins_optimal},
+                                                      {"iterations", coins.iterations}};
+        }
+        report["timedOut"] = timed_out;
+    }
+
+    /// Star thresholds from the distribution of walk lengths, and that
+    /// distribution up to the one-star threshold: `counts[length]` is the
+    /// number of walks to an exit of that length, which may pass a stop
+    /// more than once. Both are empty if there is no way out.
+    struct walk_distribution
+    {
+        std::vector<std::size_t> thresholds;
+        std::vector<std::uint64_t> counts;
+    };
+
+    walk_distribution walk_distribution_of(chilly::move_graph const &graph)
+    {
+        chilly::route_space const routes(graph, false);
+        walk_distribution d;
+        d.thresholds = routes.thresholds();
+        if (!d.thresholds.empty())
+        {
+            d.counts = routes.count_walks_by_length(d.thresholds.back());
+        }
+        return d;
+    }
+
+    /// Replace the thresholds `add_routes()` derived from the shortest
+    /// route alone by `thresholds`, and add "walkCounts", the number of
+    /// walks to an exit per length, loops included, from `counts`, which
+    /// starts at the length of the three-star threshold.
+    void add_thresholds(boost::json::object &report, std::span<std::size_t const> thresholds,
+                        std::span<std::uint64_t const> counts)
+    {
+        if (thresholds.empty())
+            return;
+        boost::json::object walk_counts;
+        for (std::size_t i = 0; i < counts.size(); ++i)
+        {
+            if (counts[i] != 0)
+            {
+                walk_counts[std::to_string(thresholds.front() + i)] = counts[i];
+            }
+        }
+        report["thresholds"] = boost::json::array(std::begin(thresholds), std::end(thresholds));
+        report["walkCounts"] = std::move(walk_counts);
+    }
+
+    /// Solve one level for the batch report: the shortest route to an exit,
+    /// the shortest route found that collects every coin on the way, and
+    /// star thresholds from the lengths of all routes there are. The fields
+    /// are added to `report`, which names the level for the caller. A level
+    /// whose board is in `pack`, compared tile by tile, is not solved again
+    /// but reported from there, with "cached" set, as long as its coin route
+    /// is proven minimal or proven not to exist; one that is solved is
+    /// handed to `writer`, if any. `timeout` only limits the search for the
+    /// coin route; the graph, the shortest route and the thresholds are
+    /// always found in full.
+    boost::json::object solve_level(chilly::level const &lvl, boost::json::object report, clock::duration timeout,
+                                    chilly::path_search search = chilly::path_search::breadth_first,
+                                    chilly::level_pack const *pack = nullptr,
+                                    chilly::level_pack_writer *writer = nullptr, std::size_t index = 0)
+    {
+        auto const t0 = clock::now();
+        report["name"] = lvl.name;
+        if (!is_rectangular(lvl.data))
+        {
+            report["error"] = "rows differ in width";
+            return report;
+        }
+
+        if (pack != nullptr)
+        {
+            // a coin route cut short by the timeout is looked for again
+            auto const cached = pack->find(chilly::content_hash(lvl.data));
+            if (cached && cached->matches(lvl.data) &&
+                (cached->coins_optimal || (!cached->coins.found && !cached->coins_timed_out)))
+            {
+                report["nodes"] = cached->node_count();
+                report["edges"] = cached->edges.size();
+                add_routes(report,
+                           route_summary{cached->shortest.found, std::string(cached->shortest.moves), cached->shortest.iterations},
+                           route_summary{cached->coins.found, std::string(cached->coins.moves), cached->coins.iterations},
+                           cached->coins_optimal, cached->coins_timed_out);
+                std::vector<std::size_t> const thresholds(std::begin(cached->thresholds), std::end(cached->thresholds));
+                add_thresholds(report, thresholds, cached->walk_counts);
+                report["cached"] = true;
+                report["wallTimeMs"] = milliseconds_since(t0);
+                if (writer != nullptr)
+                {
+                    writer->set(index, *cached);
+                }
+                return report;
+            }
+        }
+
+        chilly::solver solver(lvl.data);
+        chilly::solver::result shortest = solver.shortest_path(search);
+        chilly::move_graph const &graph = solver.graph();
+        chilly::distance_matrix const distances(graph);
+        chilly::tour_solver const tour(graph, distances);
+        chilly::tour_solver::result coins = tour.solve(1, t0 + timeout);
+
+        report["nodes"] = graph.size();
+        report["edges"] = graph.edge_count();
+        add_routes(report,
+                   route_summary{!shortest.route.empty(), chilly::moves_of(shortest.route), shortest.iterations},
+                   route_summary{!coins.route.empty(), chilly::moves_of(coins.route), coins.iterations},
+                   coins.optimal, coins.timed_out);
+        walk_distribution const distribution = walk_distribution_of(graph);
+        std::span<std::uint64_t const> counts(distribution.counts);
+        add_thresholds(report, distribution.thresholds,
+                       distribution.thresholds.empty() ? counts : counts.subspan(std::min(distribution.thresholds.front(), counts.size())));
+        report["stats"] = boost::json::value_from(solver.stats());
+        report["wallTimeMs"] = milliseconds_since(t0);
+        if (writer != nullptr)
+        {
+            writer->set(index, lvl.name, lvl.data, graph, shortest, coins, distribution.thresholds, distribution.counts);
+        }
+        return report;
+    }
+
+    /// Solve every level of a level file concurrently and print one JSON
+    /// document with a report per level, in level order. Levels are handed
+    /// to the workers as they are read, with no more than two per worker
+    /// waiting, so only the levels being solved are held in memory. With a
+    /// pack file, levels found in it are taken from there, and the pack is
+    /// rewritten if any level had to be solved.
+    int solve_all(chilly::level_reader &reader, std::string const &level_file, std::size_t threads, clock::duration timeout,
+                  std::string const &pack_path)
+    {
+        auto const t0 = clock::now();
+        // a deque keeps the reports in place as more are added
+        std::deque<boost::json::object> reports;
+        std::unique_ptr<chilly::level_pack> pack;
+        std::unique_ptr<chilly::level_pack_writer> writer;
+        if (!pack_path.empty())
+        {
+            pack = std::make_unique<chilly::level_pack>(pack_path);
+            writer = std::make_unique<chilly::level_pack_writer>();
+        }
+        clock::duration waited{0};
+        bool complete = false;
+        double parse_ms = 0;
+        {
+            chilly::thread_pool pool(threads);
+            std::counting_semaphore<> slots(static_cast<std::ptrdiff_t>(2 * pool.size()));
+            auto const read_start = clock::now();
+            complete = reader.for_each([&](std::size_t i, chilly::level_grid const &grid)
+                                       {
+                                           auto const wait_start = clock::now();
+                                           slots.acquire();
+                                           waited += clock::now() - wait_start;
+                                           boost::json::object *report = &reports.emplace_back();
+                                           pool.submit([lvl = grid.to_level(), report, &slots, &pack, &writer, i, timeout]()
+                                                       {
+                                                           *report = solve_level(lvl, boost::json::object{{"level", i + 1}}, timeout,
+                                                                                 chilly::path_search::breadth_first, pack.get(), writer.get(), i);
+                                                           slots.release(); });
+                                           return true; });
+            // time spent reading, not waiting for a worker to take a level
+            parse_ms = std::chrono::duration<double, std::milli>(clock::now() - read_start - waited).count();
+            pool.wait();
+        }
+        if (!complete)
+        {
+            std::cerr << "Cannot read levels from " << level_file << ": " << reader.error() << '\n';
+            return EXIT_FAILURE;
+        }
+        if (writer != nullptr)
+        {
+            // levels that cannot be solved are left out of the pack
+            auto const packed = std::count_if(std::begin(reports), std::end(reports), [](boost::json::object const &r)
+                                              { return !r.contains("error"); });
+            auto const cached = std::count_if(std::begin(reports), std::end(reports), [](boost::json::object const &r)
+                                              { return r.contains("cached"); });
+            bool const stale = cached != packed || pack->size() != static_cast<std::size_t>(packed);
+            if (stale && !writer->write(pack_path))
+            {
+                std::cerr << "Cannot write level pack " << pack_path << '\n';
+            }
+        }
+        boost::json::array results;
+        for (auto &report : reports)
+        {
+            results.emplace_back(std::move(report));
+        }
+        boost::json::object document;
+        document["levels"] = std::move(results);
+        document["parseMs"] = parse_ms;
+        document["wallTimeMs"] = milliseconds_since(t0);
+        std::cout << boost::json::serialize(document) << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    bool parse_search(std::string const &mode, chilly::path_search &search)
+    {
+        if (mode == "astar")
+        {
+            search = chilly::path_search::a_star;
+        }
+        else if (mode == "bidir")
+        {
+            search = chilly::path_search::bidirectional;
+        }
+        else if (mode == "bfs")
+        {
+            search = chilly::path_search::breadth_first;
+        }
+        else if (mode == "parallel")
+        {
+            search = chilly::path_search::parallel;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    /// Answer one request line of the server with the batch report of its
+    /// level, or with an error. The request's "id", if any, is copied into
+    /// the response, as responses are sent in the order they are ready.
+    std::string answer(std::string const &line, clock::duration default_timeout, chilly::level_pack const *pack)
+    {
+        boost::json::object response;
+        boost::json::error_code ec;
+        boost::json::value const request = boost::json::parse(line, ec);
+        if (ec || !request.is_object())
+        {
+            response["id"] = nullptr;
+            response["error"] = "request is not a JSON object";
+            return boost::json::serialize(response);
+        }
+        auto const &o = request.as_object();
+        response["id"] = o.contains("id") ? o.at("id") : boost::json::value(nullptr);
+        if (!o.contains("level"))
+        {
+            response["error"] = "request has no level";
+            return boost::json::serialize(response);
+        }
+        try
+        {
+            chilly::level const lvl = boost::json::value_to<chilly::level>(o.at("level"));
+            clock::duration timeout = default_timeout;
+            if (o.contains("timeout"))
+            {
+                timeout = timeout_of(o.at("timeout").to_number<double>());
+            }
+            chilly::path_search search = chilly::path_search::breadth_first;
+            if (o.contains("search") && !parse_search(boost::json::value_to<std::string>(o.at("search")), search))
+            {
+                response["error"] = "unknown search mode";
+            }
+            else
+            {
+                response = solve_level(lvl, std::move(response), timeout, search, pack);
+            }
+        }
+        catch (std::exception const &e)
+        {
+            response["error"] = e.what();
+        }
+        return boost::json::serialize(response);
+    }
+
+#ifndef _WIN32
+    /// One client of the server: request lines are read from one file
+    /// descriptor, response lines written to another by whichever worker
+    /// finishes a request. Requests in flight hold on to their connection,
+    /// so a socket is closed once its client hung up and the last of them
+    /// has been answered. At most `MAX_REQUESTS_IN_FLIGHT` of them are, so
+    /// a client sending faster than it is served is not read any further
+    /// until answers have drained.
+    class connection
+    {
+    public:
+        connection(int in, int out, bool owns_descriptors)
+            : _in(in), _out(out), _owns_descriptors(owns_descriptors)
+        {
+        }
+
+        ~connection()
+        {
+            if (_owns_descriptors)
+            {
+                ::close(_in);
+                if (_out != _in)
+                {
+                    ::close(_out);
+                }
+            }
+        }
+
+        connection(connection const &) = delete;
+        connection &operator=(connection const &) = delete;
+
+        /// Read the next line without its newline; false at the end of input.
+        bool read_line(std::string &line)
+        {
+            for (;;)
+            {
+                std::size_t const eol = _buffer.find('\n', _scanned);
+                if (eol != std::string::npos)
+                {
+                    line.assign(_buffer, 0, eol);
+                    _buffer.erase(0, eol + 1);
+                    _scanned = 0;
+                    return true;
+                }
+                _scanned = _buffer.size();
+                char chunk[1 << 16];
+                ssize_t const n = ::read(_in, chunk, sizeof(chunk));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                {
+                    // a last request need not end with a newline
+                    line = std::move(_buffer);
+                    _buffer.clear();
+                    _scanned = 0;
+                    return !line.empty();
+                }
+                _buffer.append(chunk, static_cast<std::size_t>(n));
+            }
+        }
+
+        /// Wait for a free slot for another request in flight and take it.
+        void begin_request()
+        {
+            std::unique_lock<std::mutex> lock(_flight_mutex);
+            _answered.wait(lock, [this]()
+                           { return _in_flight < MAX_REQUESTS_IN_FLIGHT; });
+            ++_in_flight;
+        }
+
+        void end_request()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_flight_mutex);
+                --_in_flight;
+            }
+            _answered.notify_all();
+        }
+
+        /// Wait until every request taken has been answered.
+        void wait_answered()
+        {
+            std::unique_lock<std::mutex> lock(_flight_mutex);
+            _answered.wait(lock, [this]()
+                           { return _in_flight == 0; });
+        }
+
+        /// Write `line` and a newline in one piece. Errors are ignored: a
+        /// client that went away just misses its answers.
+        void write_line(std::string line)
+        {
+            line.push_back('\n');
+            std::lock_guard<std::mutex> lock(_write_mutex);
+            for (std::size_t written = 0; written < line.size();)
+            {
+                ssize_t const n = ::write(_out, line.data() + written, line.size() - written);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    return;
+                written += static_cast<std::size_t>(n);
+            }
+        }
+
+    private:
+        int _in;
+        int _out;
+        bool _owns_descriptors;
+        std::string _buffer;
+        std::size_t _scanned{0};
+        std::mutex _write_mutex;
+        std::mutex _flight_mutex;
+        std::condition_variable _answered;
+        std::size_t _in_flight{0};
+    };
+
+    /// Hand every request of `client` to the pool as it arrives, and return
+    /// once the client has hung up and all of them have been answered.
+    void serve_connection(std::shared_ptr<connection> client, chilly::thread_pool &pool, clock::duration timeout,
+                          chilly::level_pack const *pack)
+    {
+        std::string line;
+        while (client->read_line(line))
+        {
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            client->begin_request();
+            pool.submit([client, line, timeout, pack]()
+                        {
+                            client->write_line(answer(line, timeout, pack));
+                            client->end_request(); });
+        }
+        client->wait_answered();
+    }
+
+    int listen_on(std::string const &path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            std::cerr << "Socket path too long: " << path << '\n';
+            return -1;
+        }
+        std::copy(std::begin(path), std::end(path), address.sun_path);
+        // replace the socket of a previous run, but nothing else
+        struct stat existing;
+        if (::stat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode))
+        {
+            ::unlink(path.c_str());
+        }
+        int const fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 ||
+            ::bind(fd, reinterpret_cast<sockaddr const *>(&address), sizeof(address)) < 0 ||
+            ::listen(fd, SOMAXCONN) < 0)
+        {
+            std::cerr << "Cannot listen on " << path << ": " << std::strerror(errno) << '\n';
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            return -1;
+        }
+        return fd;
+    }
+
+    /// Keep answering requests, one JSON object per line, until standard
+    /// input ends or, with a socket path, for good. Every client may have
+    /// several requests in flight; all of them share one pool of workers.
+    /// Up to `MAX_CONNECTIONS` clients are served at a time.
+    /// Levels found in the pack at `pack_path`, if any, are not solved.
+    int serve(std::string const &socket_path, std::size_t threads, clock::duration timeout, std::string const &pack_path)
+    {
+        std::unique_ptr<chilly::level_pack> const pack = pack_path.empty() ? nullptr : std::make_unique<chilly::level_pack>(pack_path);
+        // a client closing its end early must not take the server down
+        std::signal(SIGPIPE, SIG_IGN);
+        chilly::thread_pool pool(threads);
+        if (socket_path.empty())
+        {
+            serve_connection(std::make_shared<connection>(STDIN_FILENO, STDOUT_FILENO, false), pool, timeout, pack.get());
+            pool.wait();
+            return EXIT_SUCCESS;
+        }
+        int const listener = listen_on(socket_path);
+        if (listener < 0)
+            return EXIT_FAILURE;
+        std::counting_semaphore<> connection_slots(static_cast<std::ptrdiff_t>(MAX_CONNECTIONS));
+        for (;;)
+        {
+            connection_slots.acquire();
+            int const fd = ::accept(listener, nullptr, nullptr);
+            if (fd < 0)
+            {
+                connection_slots.release();
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                std::cerr << "accept() failed: " << std::strerror(errno) << '\n';
+                ::close(listener);
+                return EXIT_FAILURE;
+            }
+            std::thread([client = std::make_shared<connection>(fd, fd, true), &pool, timeout, pack = pack.get(), &connection_slots]()
+                        {
+                            serve_connection(client, pool, timeout, pack);
+                            connection_slots.release(); })
+                .detach();
+        }
+    }
+#endif
+}
 
 int main(int argc, char *argv[])
 {
-    if (argc < 3)
+    bool exact = false;
+    std::size_t ida_bytes = 0;
+    std::size_t k_best_routes = 0;
+    bool all = false;
+    bool stats_json = false;
+    bool server = false;
+    std::string socket_path;
+    std::string pack_path;
+    std::size_t batch_threads = std::thread::hardware_concurrency();
+    double timeout_seconds = DEFAULT_TIMEOUT_SECONDS;
+    bool timeout_given = false;
+    chilly::solve_options options;
+    chilly::path_search search = chilly::path_search::breadth_first;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--exact")
+        {
+            exact = true;
+        }
+        else if (arg == "--ida" && i + 1 < argc)
+        {
+            ida_bytes = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i]))) << 20;
+        }
+        else if (arg == "--routes" && i + 1 < argc)
+        {
+            k_best_routes = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (arg == "--prune")
+        {
+            options.prune = true;
+        }
+        else if (arg == "--all")
+        {
+            all = true;
+        }
+        else if (arg == "--stats=json")
+        {
+            stats_json = true;
+        }
+        else if (arg == "--serve")
+        {
+            server = true;
+        }
+        else if (arg == "--pack" && i + 1 < argc)
+        {
+            pack_path = argv[++i];
+        }
+        else if (arg == "--socket" && i + 1 < argc)
+        {
+            server = true;
+            socket_path = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            options.threads = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+            batch_threads = options.threads;
+        }
+        else if (arg == "--transpositions" && i + 1 < argc)
+        {
+            options.transposition_bytes = static_cast<std::size_t>(std::max(0, std::atoi(argv[++i]))) << 20;
+        }
+        else if (arg == "--search" && i + 1 < argc)
+        {
+            std::string const mode = argv[++i];
+            if (!parse_search(mode, search))
+            {
+                std::cerr << "Unknown search mode: " << mode << '\n';
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--timeout" && i + 1 < argc)
+        {
+            timeout_seconds = std::max(0.0, std::atof(argv[++i]));
+            timeout_given = true;
+        }
+        else if (arg == "--max-iterations" && i + 1 < argc)
+        {
+            options.max_iterations = static_cast<std::size_t>(std::max(0LL, std::atoll(argv[++i])));
+        }
+        else
+        {
+            args.push_back(arg);
+        }
+    }
+
+    if (server)
     {
-        std::cerr << "\nUsage: chilly_solver LEVEL_FILE N\n\n"
+#ifndef _WIN32
+        auto const timeout = timeout_of(timeout_seconds);
+        return serve(socket_path, batch_threads, timeout, pack_path);
+#else
+        std::cerr << "Server mode is not available on this platform.\n";
+        return EXIT_FAILURE;
+#endif
+    }
+
+    if (args.size() < (all ? 1 : 2))
+    {
+        std::cerr << "\nUsage: chilly_solver [OPTIONS] LEVEL_FILE N\n"
+                  << "       chilly_solver --all [--pack FILE] [--threads N] [--timeout SECONDS] LEVEL_FILE\n"
+                  << "       chilly_solver --serve [--socket PATH] [--pack FILE] [--threads N]\n"
+                  << "                             [--timeout SECONDS]\n\n"
                   << "  LEVEL_FILE      JSON file with level data\n"
-                  << "  N               Level number to solve\n\n";
+                  << "  N               Number or name of the level to solve\n\n"
+                  << "Options:\n"
+                  << "  --all           Solve every level concurrently and print a JSON report\n"
+                  << "                  with the shortest route, the coin route, suggested\n"
+                  << "                  thresholds, iterations and wall time per level\n"
+                  << "  --serve         Keep running and answer requests, one JSON object per\n"
+                  << "                  line on stdin, with one line of JSON per request on\n"
+                  << "                  stdout as soon as it is solved. A request carries a\n"
+                  << "                  \"level\" in the format of LEVEL_FILE and optionally an\n"
+                  << "                  \"id\" to find its response by, a \"timeout\" in seconds\n"
+                  << "                  for its coin route and a \"search\" mode; the response\n"
+                  << "                  is its --all report\n"
+                  << "  --socket PATH   Serve clients connecting to a Unix socket at PATH instead\n"
+                  << "                  of stdin, 64 at a time, each with up to 16 requests\n"
+                  << "                  in flight of their own\n"
+                  << "  --pack FILE     Take the routes of levels whose board is unchanged from the\n"
+                  << "                  level pack FILE instead of solving them again; --all\n"
+                  << "                  creates or updates it with every level solved\n"
+                  << "  --timeout S     Give up looking for a better coin route of a level\n"
+                  << "                  after S seconds (default in batch and server mode: 10,\n"
+                  << "                  otherwise no limit) and report the best one found;\n"
+                  << "                  the shortest route and the thresholds are always\n"
+                  << "                  found in full\n"
+                  << "  --max-iterations N\n"
+                  << "                  Stop the depth-first search after it has looked at N\n"
+                  << "                  moves and report the best routes found\n"
+                  << "  --exact         Find a minimal route collecting all coins by searching\n"
+                  << "                  the (node, collected coins) state space instead of\n"
+                  << "                  enumerating all routes\n"
+                  << "  --ida MB        Find a minimal route collecting all coins by iterative-\n"
+                  << "                  deepening A* over the same state space, holding no more\n"
+                  << "                  than MB megabytes in the move graph and the search's\n"
+                  << "                  own tables; slower than --exact, but for levels whose\n"
+                  << "                  states do not fit into memory. The parsed level, the\n"
+                  << "                  nodes the graph was built from and the bounds' brief\n"
+                  << "                  scratch space come on top\n"
+                  << "  --routes K      List the K shortest routes that collect all coins and\n"
+                  << "                  never pass the same stop with the same coins twice,\n"
+                  << "                  found by Yen's algorithm instead of the depth-first\n"
+                  << "                  search, how many walks there are of each length up to\n"
+                  << "                  the longest of them, passing a state more than once\n"
+                  << "                  included, and the thresholds --all suggests\n"
+                  << "  --stats=json    Print timings per phase, graph size, search counters and\n"
+                  << "                  the memory high-water mark as JSON to stderr\n"
+                  << "  --search MODE   Find the shortest route ignoring coins breadth-first\n"
+                  << "                  (bfs, the default), with A* (astar), searching from\n"
+                  << "                  the player and the exits at once (bidir), or over the\n"
+                  << "                  cells of the board on all threads (parallel), which\n"
+                  << "                  suits boards too large for the move graph\n"
+                  << "  --prune         Let the depth-first search skip branches that provably\n"
+                  << "                  cannot improve on the routes found so far\n"
+                  << "  --transpositions MB\n"
+                  << "                  Heuristic: let the depth-first search skip states (stop,\n"
+                  << "                  coins collected) it has reached sooner before,\n"
+                  << "                  remembering up to MB megabytes of them. Faster, but it\n"
+                  << "                  may miss routes, the shortest one included, and does\n"
+                  << "                  not prove the routes it finds minimal\n"
+                  << "  --threads N     Run the depth-first search and the parallel search on\n"
+                  << "                  N threads, or solve N levels at a time in batch and\n"
+                  << "                  server mode\n\n";
         return EXIT_FAILURE;
     }
 
     std::size_t keep_n_best_routes = KEEP_N_BEST_ROUTES;
 
-    std::ifstream ifs(argv[1]);
-    std::string input(std::istreambuf_iterator<char>(ifs), {});
-    std::vector<chilly::level> levels =
-        boost::json::value_to<std::vector<chilly::level>>(boost::json::parse(input));
+    auto const parse_start = clock::now();
+    chilly::level_reader reader(args.at(0));
+    chilly::solve_stats stats;
+    if (all)
+    {
+        return solve_all(reader, args.at(0), batch_threads, timeout_of(timeout_seconds), pack_path);
+    }
+
+    // a level is picked by its number or, failing that, by its name; only
+    // the file up to that level is read
+    std::string const &wanted = args.at(1);
+    bool const by_number = !wanted.empty() && std::all_of(std::begin(wanted), std::end(wanted), [](char c)
+                                                          { return c >= '0' && c <= '9'; });
+    std::size_t const number = by_number ? static_cast<std::size_t>(std::strtoull(wanted.c_str(), nullptr, 10)) : 0;
+    if (by_number && number == 0)
+    {
+        std::cerr << "Levels are numbered from 1.\n";
+        return EXIT_FAILURE;
+    }
+    std::optional<chilly::level_grid> const grid =
+        by_number ? reader.find(number - 1) : reader.find(std::string_view(wanted));
+    stats.parse_ms = milliseconds_since(parse_start);
+    if (!grid.has_value())
+    {
+        std::cerr << (reader.error().empty() ? "No level " + wanted + " in " + args.at(0)
+                                             : "Cannot read levels from " + args.at(0) + ": " + reader.error())
+                  << '\n';
+        return EXIT_FAILURE;
+    }
+    if (!grid->rectangular)
+    {
+        std::cerr << "The rows of level " << wanted << " differ in width.\n";
+        return EXIT_FAILURE;
+    }
+    chilly::level const lvl = grid->to_level();
+    auto print_stats = [&stats, stats_json]()
+    {
+        if (stats_json)
+        {
+            std::cerr << boost::json::serialize(boost::json::value_from(stats)) << std::endl;
+        }
+    };
 
-    int level_idx = std::atoi(argv[2]) - 1;
-    auto level_data = levels.at(level_idx).data;
-    levels.at(level_idx).dump();
+    auto const &level_data = lvl.data;
+    lvl.dump();
 
     std::cout << '\n'
-              << "Breadth-First Search running ... ";
+              << (search == chilly::path_search::a_star          ? "A* Search running ... "
+                  : search == chilly::path_search::bidirectional ? "Bidirectional Search running ... "
+                  : search == chilly::path_search::parallel      ? "Parallel Breadth-First Search running ... "
+                                                                 : "Breadth-First Search running ... ");
     chilly::solver solver(level_data);
-    chilly::solver::result result = solver.shortest_path();
+    chilly::solver::result result = solver.shortest_path(search, batch_threads);
+    stats += solver.stats();
 
-    std::cout << "\n\nVisited nodes: " << solver.nodes().size() << '\n';
+    std::cout << "\n\nVisited nodes: " << solver.nodes().size() << '\n'
+              << "Expanded nodes: " << solver.stats().states_expanded << '\n';
     if (result.route.empty())
     {
         std::cout << "BFS: no solution found.\n";
@@ -53,17 +819,144 @@ int main(int argc, char *argv[])
                   << result.iterations << '\n'
                   << "Shortest path ignoring collectibles has "
                   << (result.route.size() - 1) << " moves: ";
-        for (auto const &hop : result.route)
+        for (auto hop = result.route.begin() + 1; hop != result.route.end(); ++hop)
         {
-            std::cout << hop.move;
+            std::cout << hop->move;
         }
         std::cout << "\n-------------------------\n";
     }
 
+    if (exact)
+    {
+        std::cout << "Exact coin-aware search running ... ";
+        chilly::solver solver2(level_data);
+        chilly::solver::result exact_result = solver2.solve_exact();
+        stats += solver2.stats();
+        std::cout << "\n\nVisited nodes: " << solver2.nodes().size() << '\n'
+                  << "Iterations: " << exact_result.iterations << '\n';
+        if (exact_result.route.empty())
+        {
+            std::cout << "Exact search: no solution found.\n";
+        }
+        else
+        {
+            std::cout << "\nShortest path has " << (exact_result.route.size() - 1) << " moves: ";
+            for (auto hop = exact_result.route.begin() + 1; hop != exact_result.route.end(); ++hop)
+            {
+                std::cout << hop->move;
+            }
+            std::cout << '\n';
+        }
+        std::cout << std::endl;
+        print_stats();
+        return EXIT_SUCCESS;
+    }
+
+    if (ida_bytes > 0)
+    {
+        std::cout << "Iterative-deepening A* search running ... ";
+        // the move graph is shared with the first search rather than built
+        // a second time; it is only built now if that search did without
+        chilly::move_graph const &graph = solver.graph();
+        chilly::solve_stats graph_stats;
+        graph_stats.parse_ms = stats.parse_ms;
+        graph_stats += solver.stats();
+        stats = graph_stats;
+        auto const ida_start = clock::now();
+        chilly::ida_solver const ida(graph, ida_bytes);
+        chilly::ida_solver::result const ida_result =
+            ida.solve(timeout_given ? ida_start + timeout_of(timeout_seconds)
+                                    : clock::time_point::max());
+        stats.search_ms += milliseconds_since(ida_start);
+        stats.states_expanded += ida_result.states_expanded;
+        stats.states_pruned += ida_result.states_pruned;
+        stats.note_bytes(ida_result.bytes);
+        std::cout << "\n\nVisited nodes: " << solver.nodes().size() << '\n'
+                  << "Iterations: " << ida_result.iterations << " in " << ida_result.rounds << " rounds\n"
+                  << "Memory held: " << (ida_result.bytes >> 20) << " MB\n";
+        if (ida_result.out_of_memory)
+        {
+            std::cout << "The move graph and the bounds alone take more than " << (ida_bytes >> 20) << " MB.\n";
+        }
+        else if (!ida_result.optimal)
+        {
+            std::cout << "Search stopped early: no route is proven minimal.\n";
+        }
+        if (ida_result.route.empty())
+        {
+            std::cout << "IDA*: no solution found.\n";
+        }
+        else
+        {
+            std::cout << "\nShortest path has " << (ida_result.route.size() - 1) << " moves: " << chilly::moves_of(ida_result.route) << '\n';
+        }
+        std::cout << std::endl;
+        print_stats();
+        return ida_result.out_of_memory ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    if (k_best_routes > 0)
+    {
+        std::cout << "k shortest routes search running ... ";
+        chilly::route_space const with_coins(solver.graph(), true);
+        if (!with_coins.complete())
+        {
+            std::cout << "\n\nToo many states (stop, coins collected) to list routes.\n";
+            print_stats();
+            return EXIT_FAILURE;
+        }
+        std::vector<chilly::path> const routes = with_coins.k_shortest(k_best_routes);
+        std::cout << "\n\nStates: " << with_coins.size() << '\n';
+        if (routes.empty())
+        {
+            std::cout << "No route collects all coins.\n";
+        }
+        for (auto const &path : routes)
+        {
+            std::cout << (path.size() - 1) << ": " << chilly::moves_of(path) << '\n';
+        }
+        if (!routes.empty())
+        {
+            // beyond the shortest length, walks outnumber the routes above
+            std::vector<std::uint64_t> const counts = with_coins.count_walks_by_length(routes.back().size() - 1);
+            std::cout << "\nWalks per length, loops included:\n";
+            for (std::size_t length = routes.front().size() - 1; length < counts.size(); ++length)
+            {
+                std::cout << length << ": " << counts[length]
+                          << (counts[length] == UINT64_MAX ? " or more" : "") << '\n';
+            }
+        }
+        std::vector<std::size_t> const thresholds = chilly::route_space(solver.graph(), false).thresholds();
+        if (!thresholds.empty())
+        {
+            std::cout << "\nThresholds: " << thresholds[0] << ' ' << thresholds[1] << ' ' << thresholds[2] << '\n';
+        }
+        std::cout << std::endl;
+        print_stats();
+        return EXIT_SUCCESS;
+    }
+
     std::cout << "Depth-First Search running ... \n";
+    if (timeout_given)
+    {
+        options.deadline = clock::now() + timeout_of(timeout_seconds);
+    }
+    options.on_progress = [](std::size_t iterations, std::vector<std::size_t> const &lengths)
+    {
+        std::cout << '\r' << iterations << " iterations: ";
+        for (std::size_t length : lengths)
+        {
+            std::cout << length << ' ';
+        }
+    };
     chilly::solver solver2(level_data);
-    auto routes = solver2.solve(keep_n_best_routes);
+    auto routes = solver2.solve(keep_n_best_routes, options);
+    stats += solver2.stats();
     std::cout << "\n\nVisited nodes: " << solver2.nodes().size() << '\n';
+    if (!solver2.proven_optimal())
+    {
+        std::cout << "Search stopped early or its transposition table cut off branches: routes are not proven minimal.\n";
+    }
     if (routes.empty())
     {
         std::cout << "DFS: no solution found.\n";
@@ -95,5 +988,6 @@ int main(int argc, char *argv[])
         std::cout << '\n';
     }
     std::cout << std::endl;
+    print_stats();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,122 @@
+#include "thread_pool.hpp"
+
+namespace chilly
+{
+    namespace
+    {
+        thread_local thread_pool const *current_pool = nullptr;
+        thread_local std::size_t current_worker = 0;
+    }
+
+    thread_pool::thread_pool(std::size_t thread_count)
+    {
+        if (thread_count == 0)
+        {
+            thread_count = 1;
+        }
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            _queues.emplace_back(std::make_unique<worker_queue>());
+        }
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            _threads.emplace_back(&thread_pool::run, this, i);
+        }
+    }
+
+    thread_pool::~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _work_available.notify_all();
+        for (auto &thread : _threads)
+        {
+            thread.join();
+        }
+    }
+
+    std::size_t thread_pool::size() const
+    {
+        return _threads.size();
+    }
+
+    void thread_pool::submit(std::function<void()> task)
+    {
+        std::size_t const index = current_pool == this
+                                      ? current_worker
+                                      : _next_queue.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+        {
+            // count the task before publishing it, so that a worker never
+            // finishes a task that has not been counted yet
+            std::lock_guard<std::mutex> lock(_mutex);
+            ++_unfinished;
+            _queued.fetch_add(1, std::memory_order_release);
+        }
+        {
+            std::lock_guard<std::mutex> lock(_queues[index]->mutex);
+            _queues[index]->tasks.push_back(std::move(task));
+        }
+        _work_available.notify_one();
+    }
+
+    void thread_pool::wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _all_done.wait(lock, [this]
+                       { return _unfinished == 0; });
+    }
+
+    bool thread_pool::take(std::size_t index, std::function<void()> &task)
+    {
+        {
+            worker_queue &own = *_queues[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < _queues.size(); ++i)
+        {
+            worker_queue &victim = *_queues[(index + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void thread_pool::run(std::size_t index)
+    {
+        current_pool = this;
+        current_worker = index;
+        for (;;)
+        {
+            std::function<void()> task;
+            if (take(index, task))
+            {
+                _queued.fetch_sub(1, std::memory_order_acq_rel);
+                task();
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (--_unfinished == 0)
+                {
+                    _all_done.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(_mutex);
+            _work_available.wait(lock, [this]
+                                 { return _stopping || _queued.load(std::memory_order_acquire) > 0; });
+            if (_stopping && _queued.load(std::memory_order_acquire) == 0)
+                return;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef __THREAD_POOL_HPP__
+#define __THREAD_POOL_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chilly
+{
+    /// Fixed-size pool of worker threads with one task queue per worker.
+    ///
+    /// A worker takes new work from the back of its own queue and, when that
+    /// runs dry, steals from the front of the other workers' queues. Tasks
+    /// submitted from inside a worker land in that worker's queue, so a task
+    /// that splits itself keeps its subtasks local until someone idles.
+    class thread_pool
+    {
+    public:
+        explicit thread_pool(std::size_t thread_count = std::thread::hardware_concurrency());
+        ~thread_pool();
+        thread_pool(thread_pool const &) = delete;
+        thread_pool &operator=(thread_pool const &) = delete;
+
+        std::size_t size() const;
+        void submit(std::function<void()> task);
+        /// Block until every submitted task has finished. Must not be called
+        /// from inside a task.
+        void wait();
+
+    private:
+        struct worker_queue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<worker_queue>> _queues;
+        std::vector<std::thread> _threads;
+        std::mutex _mutex;
+        std::condition_variable _work_available;
+        std::condition_variable _all_done;
+        std::atomic<std::size_t> _queued{0};
+        std::size_t _unfinished{0};
+        std::atomic<std::size_t> _next_queue{0};
+        bool _stopping{false};
+
+        void run(std::size_t index);
+        bool take(std::size_t index, std::function<void()> &task);
+    };
+}
+
+#endif // __THREAD_POOL_HPP__
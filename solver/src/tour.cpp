@@ -0,0 +1,520 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <numeric>
+
+#include "thread_pool.hpp"
+#include "tour.hpp"
+
+namespace chilly
+{
+    namespace
+    {
+        const std::uint32_t Infinity = std::numeric_limits<std::uint32_t>::max() / 4;
+        const std::uint16_t NoValue = 0xffff;
+        const std::size_t ClockInterval = 1024;
+
+        std::uint32_t distance(distance_matrix const &distances, move_graph::node_id from, move_graph::node_id to)
+        {
+            std::uint16_t const d = distances(from, to);
+            return d == distance_matrix::Unreachable ? Infinity : d;
+        }
+
+        std::uint16_t clamped(std::uint32_t value)
+        {
+            return value >= NoValue ? NoValue : static_cast<std::uint16_t>(value);
+        }
+
+        std::uint32_t widened(std::uint16_t value)
+        {
+            return value == NoValue ? Infinity : value;
+        }
+    }
+
+    tour_solver::tour_solver(move_graph const &g, distance_matrix const &distances)
+        : _graph(g), _distances(distances),
+          _collectible_count(static_cast<std::size_t>(std::popcount(g.all_collected()))),
+          _to_exit(g.size(), Infinity), _nearest_exit(g.size(), move_graph::NoNode)
+    {
+        for (move_graph::node_id n = 0; n < static_cast<move_graph::node_id>(g.size()); ++n)
+        {
+            for (int slot = 0; slot < move_graph::Slots; ++slot)
+            {
+                if (g.successor(n, slot) != move_graph::NoNode && g.coins(n, slot) != 0)
+                {
+                    _edges.emplace_back(key_edge{n, g.successor(n, slot), move_graph::direction_of(slot), g.coins(n, slot)});
+                }
+            }
+        }
+        for (move_graph::node_id x = 0; x < static_cast<move_graph::node_id>(g.size()); ++x)
+        {
+            if (!g.is_exit(x))
+                continue;
+            for (move_graph::node_id n = 0; n < static_cast<move_graph::node_id>(g.size()); ++n)
+            {
+                std::uint32_t const d = distance(distances, n, x);
+                if (d < _to_exit[static_cast<std::size_t>(n)])
+                {
+                    _to_exit[static_cast<std::size_t>(n)] = d;
+                    _nearest_exit[static_cast<std::size_t>(n)] = x;
+                }
+            }
+        }
+    }
+
+    tour_solver::result tour_solver::solve(std::size_t threads, clock::time_point deadline) const
+    {
+        if (_graph.size() == 0)
+            return result{};
+        if (!use_held_karp())
+            return local_search(deadline);
+        result res = held_karp(threads, deadline);
+        if (!res.timed_out)
+            return res;
+        result fallback = local_search(deadline);
+        fallback.iterations += res.iterations;
+        fallback.timed_out = true;
+        return fallback;
+    }
+
+    bool tour_solver::use_held_karp() const
+    {
+        if (_collectible_count > MaxExactCollectibles)
+            return false;
+        std::vector<bool> is_head(_graph.size(), false);
+        std::vector<bool> is_tail(_graph.size(), false);
+        for (auto const &e : _edges)
+        {
+            is_head[static_cast<std::size_t>(e.head)] = true;
+            is_tail[static_cast<std::size_t>(e.tail)] = true;
+        }
+        std::size_t const columns = static_cast<std::size_t>(std::count(std::begin(is_head), std::end(is_head), true) +
+                                                             std::count(std::begin(is_tail), std::end(is_tail), true));
+        return (columns << _collectible_count) <= MaxExactStates;
+    }
+
+    path tour_solver::assemble(std::vector<std::size_t> const &edge_sequence) const
+    {
+        std::vector<move_graph::node_id> ids{move_graph::root()};
+        std::vector<direction_t> moves{NoDirection};
+        move_graph::node_id position = move_graph::root();
+        for (std::size_t i : edge_sequence)
+        {
+            key_edge const &e = _edges.at(i);
+            if (!_distances.walk(_graph, position, e.tail, ids, moves))
+                return path{};
+            ids.push_back(e.head);
+            moves.push_back(e.move);
+            position = e.head;
+        }
+        if (_nearest_exit.at(static_cast<std::size_t>(position)) == move_graph::NoNode ||
+            !_distances.walk(_graph, position, _nearest_exit.at(static_cast<std::size_t>(position)), ids, moves))
+            return path{};
+        return _graph.route(ids, moves);
+    }
+
+    tour_solver::result tour_solver::held_karp(std::size_t threads, clock::time_point deadline) const
+    {
+        std::size_t const n = _collectible_count;
+        std::uint64_t const full = _graph.all_collected();
+        if (n == 0)
+            return result{assemble({}), true, 0};
+
+        // columns of the tables: distinct heads and tails of collecting edges
+        std::vector<move_graph::node_id> heads;
+        std::vector<move_graph::node_id> tails;
+        std::vector<std::size_t> head_of(_edges.size());
+        std::vector<std::size_t> tail_of(_edges.size());
+        for (std::size_t i = 0; i < _edges.size(); ++i)
+        {
+            auto h = std::find(std::begin(heads), std::end(heads), _edges[i].head);
+            head_of[i] = static_cast<std::size_t>(std::distance(std::begin(heads), h));
+            if (h == std::end(heads))
+            {
+                heads.push_back(_edges[i].head);
+            }
+            auto t = std::find(std::begin(tails), std::end(tails), _edges[i].tail);
+            tail_of[i] = static_cast<std::size_t>(std::distance(std::begin(tails), t));
+            if (t == std::end(tails))
+            {
+                tails.push_back(_edges[i].tail);
+            }
+        }
+        std::size_t const H = heads.size();
+        std::size_t const T = tails.size();
+        std::vector<std::uint32_t> head_to_tail(H * T);
+        for (std::size_t h = 0; h < H; ++h)
+        {
+            for (std::size_t t = 0; t < T; ++t)
+            {
+                head_to_tail[h * T + t] = distance(_distances, heads[h], tails[t]);
+            }
+        }
+
+        // cost[mask * H + h]: least moves to collect exactly `mask`, the last
+        // collecting edge ending in heads[h]; reach[mask * T + t]: least moves
+        // to collect `mask` and then walk on to tails[t]
+        std::size_t const subsets = std::size_t{1} << n;
+        std::vector<std::uint16_t> cost(subsets * H, NoValue);
+        std::vector<std::uint16_t> reach(subsets * T, NoValue);
+        for (std::size_t t = 0; t < T; ++t)
+        {
+            reach[t] = clamped(distance(_distances, move_graph::root(), tails[t]));
+        }
+
+        auto value_of = [&](std::uint64_t mask, std::size_t i) -> std::uint32_t
+        {
+            std::uint64_t const coins = _edges[i].coins;
+            std::uint64_t const base = mask & ~coins;
+            std::uint32_t best = Infinity;
+            for (std::uint64_t s = (coins - 1) & coins;; s = (s - 1) & coins)
+            {
+                best = std::min(best, widened(reach[(base | s) * T + tail_of[i]]) + 1);
+                if (s == 0)
+                    break;
+            }
+            return best;
+        };
+
+        auto process = [&](std::uint64_t mask)
+        {
+            std::uint16_t *row = cost.data() + mask * H;
+            for (std::size_t i = 0; i < _edges.size(); ++i)
+            {
+                if ((_edges[i].coins & ~mask) == 0)
+                {
+                    row[head_of[i]] = std::min(row[head_of[i]], clamped(value_of(mask, i)));
+                }
+            }
+            std::uint16_t *next = reach.data() + mask * T;
+            for (std::size_t h = 0; h < H; ++h)
+            {
+                if (row[h] == NoValue)
+                    continue;
+                for (std::size_t t = 0; t < T; ++t)
+                {
+                    next[t] = std::min(next[t], clamped(row[h] + head_to_tail[h * T + t]));
+                }
+            }
+        };
+
+        // Process masks `begin` to `end` of a layer, reading the clock every
+        // `ClockInterval` masks; a large layer takes long enough on its own
+        // to overrun the deadline.
+        std::atomic<bool> expired{false};
+        auto process_range = [&](std::vector<std::uint64_t> const &layer, std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                if ((i - begin) % ClockInterval == 0 &&
+                    (expired.load(std::memory_order_relaxed) || clock::now() >= deadline))
+                {
+                    expired.store(true, std::memory_order_relaxed);
+                    return;
+                }
+                process(layer[i]);
+            }
+        };
+
+        // A subset only depends on smaller ones, so all subsets of the same
+        // size can be processed in parallel.
+        static const std::size_t MasksPerTask = 4096;
+        std::unique_ptr<thread_pool> pool = threads > 1 ? std::make_unique<thread_pool>(threads) : nullptr;
+        std::vector<std::uint64_t> layer;
+        for (std::size_t k = 1; k <= n; ++k)
+        {
+            if (expired.load() || clock::now() >= deadline)
+            {
+                result res;
+                res.timed_out = true;
+                return res;
+            }
+            layer.clear();
+            // enumerate all n-bit masks with k bits set (Gosper's hack)
+            for (std::uint64_t mask = (std::uint64_t{1} << k) - 1; mask < subsets; )
+            {
+                layer.push_back(mask);
+                std::uint64_t const c = mask & (~mask + 1);
+                std::uint64_t const r = mask + c;
+                mask = (((r ^ mask) >> 2) / c) | r;
+            }
+            if (pool == nullptr || layer.size() <= MasksPerTask)
+            {
+                process_range(layer, 0, layer.size());
+                continue;
+            }
+            for (std::size_t begin = 0; begin < layer.size(); begin += MasksPerTask)
+            {
+                std::size_t const end = std::min(layer.size(), begin + MasksPerTask);
+                pool->submit([&layer, &process_range, begin, end]()
+                             { process_range(layer, begin, end); });
+            }
+            pool->wait();
+        }
+        if (expired.load())
+        {
+            result res;
+            res.timed_out = true;
+            return res;
+        }
+
+        // leave through the nearest exit
+        std::uint32_t best = Infinity;
+        std::size_t best_head = H;
+        for (std::size_t h = 0; h < H; ++h)
+        {
+            std::uint32_t const total = widened(cost[full * H + h]) + _to_exit[static_cast<std::size_t>(heads[h])];
+            if (total < best)
+            {
+                best = total;
+                best_head = h;
+            }
+        }
+        result res{{}, true, subsets * H};
+        if (best >= Infinity)
+            return res;
+
+        // retrace the collecting edges
+        std::vector<std::size_t> sequence;
+        std::uint64_t mask = full;
+        std::size_t h = best_head;
+        while (mask != 0)
+        {
+            std::uint32_t const target = widened(cost[mask * H + h]);
+            std::size_t edge = _edges.size();
+            std::uint64_t previous = 0;
+            for (std::size_t i = 0; i < _edges.size() && edge == _edges.size(); ++i)
+            {
+                std::uint64_t const coins = _edges[i].coins;
+                if (head_of[i] != h || (coins & ~mask) != 0)
+                    continue;
+                for (std::uint64_t s = (coins - 1) & coins;; s = (s - 1) & coins)
+                {
+                    std::uint64_t const m = (mask & ~coins) | s;
+                    if (widened(reach[m * T + tail_of[i]]) + 1 == target)
+                    {
+                        edge = i;
+                        previous = m;
+                        break;
+                    }
+                    if (s == 0)
+                        break;
+                }
+            }
+            if (edge == _edges.size())
+                return retrace_failed(res, deadline);
+            sequence.push_back(edge);
+            if (previous == 0)
+                break;
+            // find the head the walk to this edge's tail started from
+            std::uint32_t const walked = widened(reach[previous * T + tail_of[edge]]);
+            std::size_t from = H;
+            for (std::size_t g = 0; g < H && from == H; ++g)
+            {
+                if (widened(cost[previous * H + g]) + head_to_tail[g * T + tail_of[edge]] == walked)
+                {
+                    from = g;
+                }
+            }
+            if (from == H)
+                return retrace_failed(res, deadline);
+            h = from;
+            mask = previous;
+        }
+        std::reverse(std::begin(sequence), std::end(sequence));
+        res.route = assemble(sequence);
+        return res;
+    }
+
+    tour_solver::result tour_solver::retrace_failed(result const &held_karp, clock::time_point deadline) const
+    {
+        // Every value in the tables should lead back to the one it was
+        // built from; should one not, fall back to the local search.
+        result fallback = local_search(deadline);
+        fallback.iterations += held_karp.iterations;
+        return fallback;
+    }
+
+    tour_solver::result tour_solver::local_search(clock::time_point deadline) const
+    {
+        std::size_t const n = _collectible_count;
+        std::vector<std::vector<std::size_t>> candidates(n);
+        for (std::size_t i = 0; i < _edges.size(); ++i)
+        {
+            for (std::uint64_t coins = _edges[i].coins; coins != 0; coins &= coins - 1)
+            {
+                candidates[static_cast<std::size_t>(std::countr_zero(coins))].push_back(i);
+            }
+        }
+        result res;
+
+        // Cost of collecting the coins in the given order, picking the best
+        // edge for each of them by a layered shortest path; staying on the
+        // same edge for consecutive coins is free.
+        std::vector<std::vector<std::uint32_t>> value(n);
+        std::vector<std::vector<std::size_t>> parent(n);
+        auto evaluate = [&](std::vector<std::size_t> const &order, std::vector<std::size_t> *sequence) -> std::uint32_t
+        {
+            ++res.iterations;
+            for (std::size_t k = 0; k < n; ++k)
+            {
+                auto const &layer = candidates[order[k]];
+                value[k].assign(layer.size(), Infinity);
+                parent[k].assign(layer.size(), 0);
+                for (std::size_t j = 0; j < layer.size(); ++j)
+                {
+                    key_edge const &e = _edges[layer[j]];
+                    if (k == 0)
+                    {
+                        value[k][j] = distance(_distances, move_graph::root(), e.tail) + 1;
+                        continue;
+                    }
+                    auto const &previous = candidates[order[k - 1]];
+                    for (std::size_t p = 0; p < previous.size(); ++p)
+                    {
+                        std::uint32_t const step = previous[p] == layer[j]
+                                                       ? 0
+                                                       : distance(_distances, _edges[previous[p]].head, e.tail) + 1;
+                        if (value[k - 1][p] + step < value[k][j])
+                        {
+                            value[k][j] = value[k - 1][p] + step;
+                            parent[k][j] = p;
+                        }
+                    }
+                }
+            }
+            std::uint32_t best = Infinity;
+            std::size_t best_j = 0;
+            auto const &last = candidates[order[n - 1]];
+            for (std::size_t j = 0; j < last.size(); ++j)
+            {
+                std::uint32_t const total = value[n - 1][j] + _to_exit[static_cast<std::size_t>(_edges[last[j]].head)];
+                if (total < best)
+                {
+                    best = total;
+                    best_j = j;
+                }
+            }
+            if (sequence != nullptr && best < Infinity)
+            {
+                sequence->clear();
+                std::size_t j = best_j;
+                for (std::size_t k = n; k-- > 0;)
+                {
+                    std::size_t const edge = candidates[order[k]][j];
+                    if (sequence->empty() || sequence->back() != edge)
+                    {
+                        sequence->push_back(edge);
+                    }
+                    if (k > 0)
+                    {
+                        j = parent[k][j];
+                    }
+                }
+                std::reverse(std::begin(*sequence), std::end(*sequence));
+            }
+            return best;
+        };
+
+        if (n == 0)
+        {
+            res.route = assemble({});
+            res.optimal = true;
+            return res;
+        }
+        for (auto const &c : candidates)
+        {
+            if (c.empty())
+                return res; // some collectible cannot be picked up at all
+        }
+
+        // start with the nearest uncollected coin, over and over
+        std::vector<std::size_t> order;
+        std::uint64_t collected = 0;
+        move_graph::node_id position = move_graph::root();
+        while (order.size() < n)
+        {
+            std::uint32_t best = Infinity;
+            std::size_t best_edge = 0;
+            for (std::size_t i = 0; i < _edges.size(); ++i)
+            {
+                if ((_edges[i].coins & ~collected) == 0)
+                    continue;
+                std::uint32_t const d = distance(_distances, position, _edges[i].tail);
+                if (d < best)
+                {
+                    best = d;
+                    best_edge = i;
+                }
+            }
+            if (best >= Infinity)
+                return res;
+            for (std::uint64_t coins = _edges[best_edge].coins & ~collected; coins != 0; coins &= coins - 1)
+            {
+                order.push_back(static_cast<std::size_t>(std::countr_zero(coins)));
+            }
+            collected |= _edges[best_edge].coins;
+            position = _edges[best_edge].head;
+        }
+
+        // improve by reversing sections (2-opt) and by moving short runs of
+        // up to three coins elsewhere (Or-opt) until nothing helps any more
+        std::uint32_t best = evaluate(order, nullptr);
+        bool improved = true;
+        for (std::size_t round = 0; improved && round < MaxLocalSearchRounds; ++round)
+        {
+            if (clock::now() >= deadline)
+            {
+                res.timed_out = true;
+                break;
+            }
+            improved = false;
+            for (std::size_t i = 0; i + 1 < n && !improved; ++i)
+            {
+                for (std::size_t j = i + 1; j < n && !improved; ++j)
+                {
+                    std::reverse(std::begin(order) + static_cast<std::ptrdiff_t>(i), std::begin(order) + static_cast<std::ptrdiff_t>(j + 1));
+                    std::uint32_t const candidate = evaluate(order, nullptr);
+                    if (candidate < best)
+                    {
+                        best = candidate;
+                        improved = true;
+                    }
+                    else
+                    {
+                        std::reverse(std::begin(order) + static_cast<std::ptrdiff_t>(i), std::begin(order) + static_cast<std::ptrdiff_t>(j + 1));
+                    }
+                }
+            }
+            for (std::size_t length = 1; length <= 3 && !improved; ++length)
+            {
+                for (std::size_t i = 0; i + length <= n && !improved; ++i)
+                {
+                    for (std::size_t j = 0; j + length <= n && !improved; ++j)
+                    {
+                        if (j == i)
+                            continue;
+                        std::vector<std::size_t> moved = order;
+                        std::vector<std::size_t> run(std::begin(moved) + static_cast<std::ptrdiff_t>(i), std::begin(moved) + static_cast<std::ptrdiff_t>(i + length));
+                        moved.erase(std::begin(moved) + static_cast<std::ptrdiff_t>(i), std::begin(moved) + static_cast<std::ptrdiff_t>(i + length));
+                        moved.insert(std::begin(moved) + static_cast<std::ptrdiff_t>(j), std::begin(run), std::end(run));
+                        std::uint32_t const candidate = evaluate(moved, nullptr);
+                        if (candidate < best)
+                        {
+                            best = candidate;
+                            order = std::move(moved);
+                            improved = true;
+                        }
+                    }
+                }
+            }
+        }
+        std::vector<std::size_t> sequence;
+        if (evaluate(order, &sequence) < Infinity)
+        {
+            res.route = assemble(sequence);
+        }
+        return res;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef __TOUR_HPP__
+#define __TOUR_HPP__
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "chilly.hpp"
+
+namespace chilly
+{
+    /// Shortest route that picks up every collectible and then leaves through
+    /// an exit, solved as a generalized travelling salesman problem.
+    ///
+    /// A collectible can be picked up on any edge that crosses its tile. Only
+    /// the edges on which a route collects something new matter; in between
+    /// it takes a shortest walk. With few collectibles the collection order is
+    /// found exactly by Held-Karp dynamic programming over (set of
+    /// collectibles, node reached by the last collecting edge), one subset
+    /// size after the other. Otherwise a 2-opt/Or-opt local search over the
+    /// order of collectibles yields a good, though not provably minimal,
+    /// route.
+    class tour_solver
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        struct result
+        {
+            path route;
+            /// true if `route` is provably minimal
+            bool optimal{false};
+            /// dynamic programming states or evaluated orders
+            std::size_t iterations{0};
+            /// true if the deadline cut the search short
+            bool timed_out{false};
+        };
+
+        /// Held-Karp is used up to this many collectibles as long as its
+        /// tables have at most `MaxExactStates` entries
+        static constexpr std::size_t MaxExactCollectibles = 25;
+        static constexpr std::size_t MaxExactStates = std::size_t{1} << 27;
+        static constexpr std::size_t MaxLocalSearchRounds = 1000;
+
+        tour_solver(move_graph const &, distance_matrix const &);
+
+        /// Past `deadline` Held-Karp is abandoned for the local search, which
+        /// in turn stops improving its route and returns what it has.
+        result solve(std::size_t threads = 1, clock::time_point deadline = clock::time_point::max()) const;
+
+    private:
+        struct key_edge
+        {
+            move_graph::node_id tail;
+            move_graph::node_id head;
+            direction_t move;
+            std::uint64_t coins;
+        };
+
+        move_graph const &_graph;
+        distance_matrix const &_distances;
+        std::size_t _collectible_count;
+        std::vector<key_edge> _edges;
+        std::vector<std::uint32_t> _to_exit;
+        std::vector<move_graph::node_id> _nearest_exit;
+
+        bool use_held_karp() const;
+        result held_karp(std::size_t threads, clock::time_point deadline) const;
+        /// Route to return if Held-Karp cannot retrace its best value:
+        /// the local search's, which is not claimed to be minimal.
+        result retrace_failed(result const &held_karp, clock::time_point deadline) const;
+        result local_search(clock::time_point deadline) const;
+        path assemble(std::vector<std::size_t> const &edge_sequence) const;
+    };
+}
+
+#endif // __TOUR_HPP__
@@ -0,0 +1,126 @@
+#ifndef __TRANSPOSITION_TABLE_HPP__
+#define __TRANSPOSITION_TABLE_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace chilly
+{
+    /// Shortest prefix length seen so far per search state (stop node, set
+    /// of collected coins), in a table of fixed size.
+    ///
+    /// Cutting off a state reached no sooner than before is a heuristic for
+    /// a search of simple paths: the earlier visit may have been barred from
+    /// nodes the later one could still pass, and two states may share a
+    /// tag. A search that was cut off, see `cut()`, proves nothing.
+    ///
+    /// States are identified by Zobrist hashes: the XOR of a random key for
+    /// the node and one for every coin collected, so a hash can be updated
+    /// incrementally as coins are picked up. Each entry packs the upper 40
+    /// bits of a hash and a length into one atomic word, which lets the
+    /// workers of a parallel search share the table without locks. Entries
+    /// come in buckets of two; a new state evicts the one that was reached
+    /// with the longer prefix, as a short prefix cuts off more branches.
+    class transposition_table
+    {
+    public:
+        transposition_table(std::size_t max_bytes, std::size_t node_count, std::size_t collectible_count)
+            : _node_keys(node_count), _coin_keys(collectible_count)
+        {
+            std::mt19937_64 rng(0x9e3779b97f4a7c15ULL);
+            for (auto &key : _node_keys)
+            {
+                key = rng();
+            }
+            for (auto &key : _coin_keys)
+            {
+                key = rng();
+            }
+            std::size_t const buckets = std::bit_floor(std::max<std::size_t>(max_bytes / (BucketSize * sizeof(std::uint64_t)), 1));
+            _mask = buckets - 1;
+            _entries = std::make_unique<std::atomic<std::uint64_t>[]>(buckets * BucketSize);
+        }
+
+        std::uint64_t node_key(std::int32_t n) const
+        {
+            return _node_keys[static_cast<std::size_t>(n)];
+        }
+
+        /// combined key of a set of coins, for XOR-ing into a hash
+        std::uint64_t coins_key(std::uint64_t coins) const
+        {
+            std::uint64_t key = 0;
+            for (; coins != 0; coins &= coins - 1)
+            {
+                key ^= _coin_keys[static_cast<std::size_t>(std::countr_zero(coins))];
+            }
+            return key;
+        }
+
+        /// Return true if the state was reached before with a prefix no
+        /// longer than `length`; otherwise remember `length` for it.
+        bool seen(std::uint64_t hash, std::uint32_t length)
+        {
+            std::uint64_t const tag = hash >> LengthBits;
+            std::uint64_t const entry = (tag << LengthBits) | std::min<std::uint64_t>(length + 1, LengthMask);
+            std::atomic<std::uint64_t> *bucket = &_entries[(hash & _mask) * BucketSize];
+            std::size_t victim = 0;
+            std::uint64_t victim_length = 0;
+            for (std::size_t i = 0; i < BucketSize; ++i)
+            {
+                std::uint64_t const current = bucket[i].load(std::memory_order_relaxed);
+                std::uint64_t const current_length = current & LengthMask;
+                if (current != 0 && (current >> LengthBits) == tag)
+                {
+                    if (current_length <= length + 1)
+                    {
+                        _cut.store(true, std::memory_order_relaxed);
+                        return true;
+                    }
+                    bucket[i].store(entry, std::memory_order_relaxed);
+                    return false;
+                }
+                // an empty slot counts as the longest prefix of all
+                std::uint64_t const rank = current == 0 ? LengthMask + 1 : current_length;
+                if (rank > victim_length)
+                {
+                    victim = i;
+                    victim_length = rank;
+                }
+            }
+            bucket[victim].store(entry, std::memory_order_relaxed);
+            return false;
+        }
+
+        /// true once `seen()` has cut off any branch
+        bool cut() const
+        {
+            return _cut.load(std::memory_order_relaxed);
+        }
+
+        std::size_t bytes() const
+        {
+            return (_mask + 1) * BucketSize * sizeof(std::uint64_t) +
+                   (_node_keys.size() + _coin_keys.size()) * sizeof(std::uint64_t);
+        }
+
+    private:
+        static constexpr std::size_t BucketSize = 2;
+        static constexpr unsigned LengthBits = 24;
+        static constexpr std::uint64_t LengthMask = (std::uint64_t{1} << LengthBits) - 1;
+
+        std::vector<std::uint64_t> _node_keys;
+        std::vector<std::uint64_t> _coin_keys;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> _entries;
+        std::size_t _mask{0};
+        std::atomic<bool> _cut{false};
+    };
+}
+
+#endif // __TRANSPOSITION_TABLE_HPP__
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "chilly.hpp"
+#include "tour.hpp"
+
+int main(int argc, char *argv[])
+{
+    std::size_t threads = 1;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else
+        {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.size() < 2)
+    {
+        std::cerr << "\nUsage: tsp [OPTIONS] LEVEL_FILE N\n\n"
+                  << "  LEVEL_FILE      JSON file with level data\n"
+                  << "  N               Level number to solve\n\n"
+                  << "Options:\n"
+                  << "  --threads N     Fill the Held-Karp tables on N threads\n\n";
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream ifs(args.at(0));
+    std::string input(std::istreambuf_iterator<char>(ifs), {});
+    std::vector<chilly::level> levels =
+        boost::json::value_to<std::vector<chilly::level>>(boost::json::parse(input));
+
+    int level_idx = std::atoi(args.at(1).c_str()) - 1;
+    levels.at(level_idx).dump();
+
+    auto t0 = std::chrono::steady_clock::now();
+    chilly::solver solver(levels.at(level_idx).data);
+    chilly::move_graph const &graph = solver.graph();
+    chilly::distance_matrix const distances(graph);
+    chilly::tour_solver const tour(graph, distances);
+    chilly::tour_solver::result result = tour.solve(threads);
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::cout << '\n'
+              << "Nodes:      " << graph.size() << '\n'
+              << "Edges:      " << graph.edge_count() << '\n'
+              << "Iterations: " << result.iterations << '\n'
+              << "Time:       " << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms\n";
+    if (result.route.empty())
+    {
+        std::cout << "No solution found.\n";
+        return EXIT_SUCCESS;
+    }
+    std::cout << (result.optimal ? "Shortest" : "Best found") << " path has " << (result.route.size() - 1) << " moves: ";
+    for (auto hop = result.route.begin() + 1; hop != result.route.end(); ++hop)
+    {
+        std::cout << hop->move;
+    }
+    std::cout << '\n'
+              << std::endl;
+    return EXIT_SUCCESS;
+}
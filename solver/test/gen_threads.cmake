@@ -0,0 +1,29 @@
+# Runs chilly_gen with the same seed on one and on three threads and fails
+# unless both runs keep the same levels.
+#
+#   cmake -DCHILLY_GEN=path/to/chilly_gen -P gen_threads.cmake
+
+if (NOT CHILLY_GEN)
+	message(FATAL_ERROR "CHILLY_GEN is not set")
+endif ()
+
+# enough boards for more than one batch of candidates on a single thread
+set(GEN_ARGS --size 16 --coins 4 --hole-pairs 1 --moves 14:40 --unique --count 20 --seed 42)
+
+foreach (THREADS 1 3)
+	execute_process(
+		COMMAND ${CHILLY_GEN} ${GEN_ARGS} --threads ${THREADS}
+		OUTPUT_VARIABLE LEVELS_${THREADS}
+		ERROR_VARIABLE LOG_${THREADS}
+		RESULT_VARIABLE RESULT_${THREADS})
+	if (NOT RESULT_${THREADS} EQUAL 0)
+		message(FATAL_ERROR "chilly_gen on ${THREADS} threads failed:\n${LOG_${THREADS}}")
+	endif ()
+endforeach ()
+
+if (NOT LEVELS_1 MATCHES "chilly_gen")
+	message(FATAL_ERROR "chilly_gen kept no levels")
+endif ()
+if (NOT LEVELS_1 STREQUAL LEVELS_3)
+	message(FATAL_ERROR "chilly_gen keeps different levels on 1 and 3 threads")
+endif ()
@@ -0,0 +1,101 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "chilly.hpp"
+#include "ida.hpp"
+#include "level_reader.hpp"
+
+// Compares the routes of the iterative-deepening A* search with those of
+// `solver::solve_exact()` on the coin levels 22 to 26 of a levels file:
+// both must be minimal, so of the same length, with a cache of 64 megabytes
+// and of one.
+// Level 26 has too many states for the exact search; there IDA* only has to
+// stop at its deadline without claiming a minimal route.
+//
+//   chilly_test_ida levels.json
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    std::size_t const FirstLevel = 22;
+    std::size_t const LastLevel = 26;
+    /// levels up to this one are solved in milliseconds
+    std::size_t const LastQuickLevel = 25;
+    auto const Deadline = std::chrono::seconds(1);
+
+    /// true if `route` follows the edges of `g` to an exit and picks up
+    /// every coin on its way
+    bool collects_all(chilly::move_graph const &g, chilly::path const &route)
+    {
+        chilly::move_graph::node_id n = chilly::move_graph::root();
+        std::uint64_t collected = 0;
+        for (std::size_t i = 1; i < route.size(); ++i)
+        {
+            int const slot = chilly::move_graph::slot_of(route[i].move);
+            if (g.successor(n, slot) == chilly::move_graph::NoNode)
+                return false;
+            collected |= g.coins(n, slot);
+            n = g.successor(n, slot);
+        }
+        return g.is_exit(n) && collected == g.all_collected();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " levels.json\n";
+        return EXIT_FAILURE;
+    }
+    chilly::level_reader reader(argv[1]);
+    std::size_t failures = 0;
+    for (std::size_t number = FirstLevel; number <= LastLevel; ++number)
+    {
+        std::optional<chilly::level_grid> const grid = reader.find(number - 1);
+        if (!grid.has_value() || !grid->rectangular)
+        {
+            std::cerr << "level " << number << ": cannot be read from " << argv[1] << '\n';
+            ++failures;
+            continue;
+        }
+        chilly::level const lvl = grid->to_level();
+        chilly::solver s(lvl.data);
+        chilly::move_graph const &g = s.graph();
+        std::optional<std::size_t> expected;
+        for (std::size_t cap : {std::size_t{64} << 20, std::size_t{1} << 20})
+        {
+            chilly::ida_solver::result const ida = chilly::ida_solver(g, cap).solve(clock::now() + Deadline);
+            std::string const label = "level " + std::to_string(number) + ", " + std::to_string(cap >> 20) + " MB: ";
+            if (ida.timed_out)
+            {
+                if (number <= LastQuickLevel || ida.optimal)
+                {
+                    std::cerr << label << "stopped at the deadline" << (ida.optimal ? " and claims a minimal route" : "") << '\n';
+                    ++failures;
+                }
+                continue;
+            }
+            if (!expected.has_value())
+            {
+                chilly::solver exact(lvl.data);
+                chilly::path const route = exact.solve_exact().route;
+                expected = route.empty() ? 0 : route.size() - 1;
+            }
+            std::size_t const length = ida.route.empty() ? 0 : ida.route.size() - 1;
+            if (!ida.optimal || length != *expected || (!ida.route.empty() && !collects_all(g, ida.route)))
+            {
+                std::cerr << label << "exact search " << *expected << " moves, IDA* " << length << " moves \""
+                          << chilly::moves_of(ida.route) << "\"" << (ida.optimal ? "" : ", not minimal") << '\n';
+                ++failures;
+            }
+        }
+    }
+    std::cout << failures << " failed\n";
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,50 @@
+# Solves a level file into a fresh level pack with a timeout too short for
+# any coin route to be proven minimal, then again with a long one, and fails
+# unless the second run looks for those routes again instead of reporting
+# them from the pack.
+#
+#   cmake -DCHILLY_SOLVER=path/to/chilly_solver -DLEVELS=levels.json
+#         -DPACK=path/to/scratch.pack -P pack_timeout.cmake
+
+if (NOT CHILLY_SOLVER OR NOT LEVELS OR NOT PACK)
+	message(FATAL_ERROR "CHILLY_SOLVER, LEVELS and PACK must be set")
+endif ()
+
+file(REMOVE ${PACK})
+
+foreach (RUN short long)
+	if (RUN STREQUAL "short")
+		set(TIMEOUT 0.000001)
+	else ()
+		set(TIMEOUT 60)
+	endif ()
+	execute_process(
+		COMMAND ${CHILLY_SOLVER} --all --pack ${PACK} --timeout ${TIMEOUT} ${LEVELS}
+		OUTPUT_VARIABLE REPORT_${RUN}
+		ERROR_VARIABLE LOG
+		RESULT_VARIABLE RESULT)
+	if (NOT RESULT EQUAL 0)
+		message(FATAL_ERROR "chilly_solver --timeout ${TIMEOUT} failed:\n${LOG}")
+	endif ()
+endforeach ()
+file(REMOVE ${PACK})
+
+# level 24 (index 23) has a 23-move coin route that the first run cannot
+# prove minimal in time
+string(JSON SHORT_OPTIMAL GET "${REPORT_short}" levels 23 coinRoute optimal)
+if (SHORT_OPTIMAL)
+	message(FATAL_ERROR "level 24 was solved within a microsecond; the test proves nothing")
+endif ()
+string(JSON LENGTH GET "${REPORT_long}" levels 23 coinRoute length)
+string(JSON OPTIMAL GET "${REPORT_long}" levels 23 coinRoute optimal)
+# "cached" is left out of the report of a level solved again
+string(JSON CACHED ERROR_VARIABLE SOLVED_AGAIN GET "${REPORT_long}" levels 23 cached)
+if (NOT LENGTH EQUAL 23 OR NOT OPTIMAL OR NOT SOLVED_AGAIN)
+	message(FATAL_ERROR "level 24 after a longer timeout: ${LENGTH} moves, optimal ${OPTIMAL}, cached ${CACHED}")
+endif ()
+
+# a level whose route was proven minimal in the first run comes from the pack
+string(JSON CACHED GET "${REPORT_long}" levels 0 cached)
+if (NOT CACHED)
+	message(FATAL_ERROR "level 1 was solved again")
+endif ()
@@ -0,0 +1,82 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "boards.hpp"
+#include "chilly.hpp"
+
+// Cross-checks the parallel breadth-first search over board cells against
+// the breadth-first search of the move graph on random boards: both must
+// find routes of the same length, the parallel one a valid route, and the
+// same route whatever the number of threads.
+
+namespace
+{
+    using board = std::vector<std::vector<chilly::tile_t>>;
+
+    /// true if replaying `route` on the move graph of `data` ends at an exit
+    bool leads_out(board const &data, chilly::path const &route)
+    {
+        chilly::solver s(data);
+        chilly::move_graph const &g = s.graph();
+        chilly::move_graph::node_id n = chilly::move_graph::root();
+        for (std::size_t i = 1; i < route.size(); ++i)
+        {
+            n = g.successor(n, chilly::move_graph::slot_of(route[i].move));
+            if (n == chilly::move_graph::NoNode)
+                return false;
+        }
+        return g.is_exit(n);
+    }
+}
+
+int main()
+{
+    std::size_t failures = 0;
+    std::size_t runs = 0;
+    for (int size : {37, 100})
+    {
+        for (unsigned rocks : {30u, 150u, 300u})
+        {
+            // at most one pair, see chilly::solver on holes
+            for (unsigned hole_pairs : {0u, 1u})
+            {
+                for (std::uint64_t seed = 0; seed < 6; ++seed)
+                {
+                    chilly::board_spec const spec{size, size, rocks, hole_pairs, 0};
+                    board const data = chilly::make_random_board(spec, seed * 7919 + static_cast<std::uint64_t>(size)).value().data;
+                    chilly::solver reference(data);
+                    chilly::path const expected = reference.shortest_path().route;
+                    std::string first;
+                    for (std::size_t threads : {1, 2, 5})
+                    {
+                        chilly::solver s(data);
+                        chilly::path const route = s.shortest_path(chilly::path_search::parallel, threads).route;
+                        std::string const moves = chilly::moves_of(route);
+                        bool ok = route.size() == expected.size() && (route.empty() || leads_out(data, route));
+                        if (threads == 1)
+                        {
+                            first = moves;
+                        }
+                        else if (moves != first)
+                        {
+                            ok = false;
+                        }
+                        if (!ok)
+                        {
+                            ++failures;
+                            std::cerr << "size " << size << ", rocks " << rocks << ", hole pairs " << hole_pairs << ", seed " << seed
+                                      << ", " << threads << " threads: breadth-first \"" << chilly::moves_of(expected)
+                                      << "\", parallel \"" << moves << "\"\n";
+                        }
+                        ++runs;
+                    }
+                }
+            }
+        }
+    }
+    std::cout << runs << " runs, " << failures << " failed\n";
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}